@@ -0,0 +1,660 @@
+#include "aabb_tree.h"
+
+// Traversals use a fixed stack.  The tree is kept balanced, so this is far more
+// than a tree built from the node budget can ever need.
+#define AABB_TREE_STACK_SIZE		(256)
+
+inline float bbox_perimeter(const bbox_aligned &box)
+{
+	return 2.0f * ((box.bbmax.x - box.bbmin.x) + (box.bbmax.y - box.bbmin.y));
+}
+
+inline void bbox_combine(const bbox_aligned &a, const bbox_aligned &b, bbox_aligned &out)
+{
+	out.bbmin = a.bbmin;
+	out.bbmax = a.bbmax;
+	out.expand(b.bbmin);
+	out.expand(b.bbmax);
+}
+
+inline bool bbox_contains(const bbox_aligned &outer, const bbox_aligned &inner)
+{
+	return outer.bbmin.x <= inner.bbmin.x && outer.bbmin.y <= inner.bbmin.y &&
+		outer.bbmax.x >= inner.bbmax.x && outer.bbmax.y >= inner.bbmax.y;
+}
+
+// max_objects: maximum number of areas in the tree at once.
+// margin: distance the fat boxes extend beyond the actual bounds on every side.
+// displacement_scale: how far ahead, in multiples of the last displacement, fat
+// boxes are stretched in the direction of motion.
+//
+aabb_tree::aabb_tree(int max_objects, float margin, float displacement_scale /*= 2.0f*/)
+{
+	Assert(max_objects > 0);
+	Assert(margin >= 0.0f);
+
+	// a full binary tree with n leaves has 2n-1 nodes.
+	m_max_nodes = MAX(max_objects, 1) * 2 - 1;
+	m_nodes = new aabb_tree_node[m_max_nodes];
+	for (int i = 0; i < m_max_nodes - 1; i++) {
+		m_nodes[i].parent = i + 1;
+	}
+	m_nodes[m_max_nodes - 1].parent = -1;
+	m_first_free = 0;
+
+	m_root = -1;
+	m_num_leaves = 0;
+	m_margin = margin;
+	m_displacement_scale = displacement_scale;
+}
+
+aabb_tree::~aabb_tree()
+{
+	if (m_nodes) {
+		delete [] m_nodes;
+	}
+}
+
+int aabb_tree::alloc_node()
+{
+	Assert_return_value(m_first_free >= 0, -1);
+
+	int node = m_first_free;
+	m_first_free = m_nodes[node].parent;
+
+	m_nodes[node].parent = -1;
+	m_nodes[node].child1 = -1;
+	m_nodes[node].child2 = -1;
+	m_nodes[node].height = 0;
+	m_nodes[node].area = NULL;
+	m_nodes[node].categories = 0;
+	return node;
+}
+
+void aabb_tree::free_node(int node)
+{
+	Assert_return(node >= 0 && node < m_max_nodes);
+
+	m_nodes[node].parent = m_first_free;
+	m_nodes[node].height = -1;
+	m_nodes[node].area = NULL;
+	m_first_free = node;
+}
+
+void aabb_tree::make_fat_box(const bounding_area &area, const vector2 &displacement, bbox_aligned &fat_box_out) const
+{
+	bounding_area_get_bounds(area, fat_box_out);
+
+	vector2 margin(m_margin, m_margin);
+	fat_box_out.bbmin -= margin;
+	fat_box_out.bbmax += margin;
+
+	// stretch toward where the area is heading.
+	vector2 predicted = displacement * m_displacement_scale;
+	fat_box_out.expand(fat_box_out.bbmin + predicted);
+	fat_box_out.expand(fat_box_out.bbmax + predicted);
+	fat_box_out.correct_corners();
+}
+
+// Add an area to the tree.  The tree does not take ownership of the area, which
+// must remain valid until it is removed.
+//
+// filter: pairs this filter rejects are never reported.
+//
+// returns: handle used to refer to the area, or -1 (and asserts) if the tree
+// already holds max_objects areas.
+//
+int aabb_tree::add(bounding_area *area, const collision_filter &filter /*= collision_filter()*/)
+{
+	Assert_return_value(area, -1);
+
+	// n leaves use 2n-1 nodes, so while there's room for the leaf there's also
+	// room for the parent insert_leaf makes for it.
+	Assert_return_value(m_num_leaves < (m_max_nodes + 1) / 2, -1);
+
+	int leaf = alloc_node();
+
+	m_nodes[leaf].area = area;
+	m_nodes[leaf].filter = filter;
+	m_nodes[leaf].categories = filter.category;
+	make_fat_box(*area, ZERO_VECTOR, m_nodes[leaf].fat_box);
+	insert_leaf(leaf);
+	m_num_leaves++;
+
+	return leaf;
+}
+
+void aabb_tree::remove(int handle)
+{
+	Assert_return(handle >= 0 && handle < m_max_nodes);
+	Assert_return(m_nodes[handle].is_leaf() && m_nodes[handle].area);
+
+	remove_leaf(handle);
+	free_node(handle);
+	m_num_leaves--;
+}
+
+// Move the area and refit the tree.
+//
+// returns: true if the area left its fat box and had to be reinserted.
+//
+bool aabb_tree::move(int handle, const vector2 &delta)
+{
+	Assert_return_value(handle >= 0 && handle < m_max_nodes, false);
+	Assert_return_value(m_nodes[handle].is_leaf() && m_nodes[handle].area, false);
+
+	m_nodes[handle].area->move(delta);
+	return update(handle, delta);
+}
+
+// Refit an area that has been moved or resized externally.
+//
+// displacement: how far the area moved, used to predict its next fat box.
+//
+// returns: true if the area left its fat box and had to be reinserted.
+//
+bool aabb_tree::update(int handle, const vector2 &displacement /*= ZERO_VECTOR*/)
+{
+	Assert_return_value(handle >= 0 && handle < m_max_nodes, false);
+	aabb_tree_node &leaf = m_nodes[handle];
+	Assert_return_value(leaf.is_leaf() && leaf.area, false);
+
+	bbox_aligned bounds;
+	bounding_area_get_bounds(*leaf.area, bounds);
+	if (bbox_contains(leaf.fat_box, bounds)) {
+		return false;
+	}
+
+	remove_leaf(handle);
+	make_fat_box(*leaf.area, displacement, leaf.fat_box);
+	insert_leaf(handle);
+	return true;
+}
+
+bounding_area *aabb_tree::get_area(int handle) const
+{
+	Assert_return_value(handle >= 0 && handle < m_max_nodes, NULL);
+	return m_nodes[handle].area;
+}
+
+// Change which pairs are reported for an area.
+//
+void aabb_tree::set_filter(int handle, const collision_filter &filter)
+{
+	Assert_return(handle >= 0 && handle < m_max_nodes);
+	Assert_return(m_nodes[handle].is_leaf() && m_nodes[handle].area);
+
+	m_nodes[handle].filter = filter;
+	m_nodes[handle].categories = filter.category;
+
+	// refresh the category unions of the ancestors.
+	int index = m_nodes[handle].parent;
+	while (index >= 0) {
+		aabb_tree_node &node = m_nodes[index];
+		node.categories = m_nodes[node.child1].categories | m_nodes[node.child2].categories;
+		index = node.parent;
+	}
+}
+
+collision_filter aabb_tree::get_filter(int handle) const
+{
+	Assert_return_value(handle >= 0 && handle < m_max_nodes, collision_filter());
+	return m_nodes[handle].filter;
+}
+
+const bbox_aligned &aabb_tree::get_fat_box(int handle) const
+{
+	Assert(handle >= 0 && handle < m_max_nodes);
+	return m_nodes[handle].fat_box;
+}
+
+int aabb_tree::get_height() const
+{
+	if (m_root < 0) {
+		return 0;
+	}
+	return m_nodes[m_root].height;
+}
+
+void aabb_tree::insert_leaf(int leaf)
+{
+	if (m_root < 0) {
+		m_root = leaf;
+		m_nodes[leaf].parent = -1;
+		return;
+	}
+
+	// Walk down to the cheapest sibling, using the perimeter of the boxes as the
+	// cost of each node.
+	const bbox_aligned &leaf_box = m_nodes[leaf].fat_box;
+	int index = m_root;
+	while (!m_nodes[index].is_leaf()) {
+		int child1 = m_nodes[index].child1;
+		int child2 = m_nodes[index].child2;
+
+		float area = bbox_perimeter(m_nodes[index].fat_box);
+
+		bbox_aligned combined;
+		bbox_combine(m_nodes[index].fat_box, leaf_box, combined);
+		float combined_area = bbox_perimeter(combined);
+
+		// cost of creating a new parent for this node and the new leaf.
+		float cost = 2.0f * combined_area;
+
+		// minimum cost of pushing the leaf further down the tree.
+		float inheritance_cost = 2.0f * (combined_area - area);
+
+		float child_cost[2];
+		int children[2] = {child1, child2};
+		for (int i = 0; i < 2; i++) {
+			const aabb_tree_node &child = m_nodes[children[i]];
+			bbox_aligned child_combined;
+			bbox_combine(leaf_box, child.fat_box, child_combined);
+			if (child.is_leaf()) {
+				child_cost[i] = bbox_perimeter(child_combined) + inheritance_cost;
+			} else {
+				child_cost[i] = bbox_perimeter(child_combined) - bbox_perimeter(child.fat_box) + inheritance_cost;
+			}
+		}
+
+		if (cost < child_cost[0] && cost < child_cost[1]) {
+			break;
+		}
+
+		index = (child_cost[0] < child_cost[1]) ? child1 : child2;
+	}
+
+	int sibling = index;
+
+	// make a new parent for the leaf and its sibling.
+	int old_parent = m_nodes[sibling].parent;
+	int new_parent = alloc_node();
+	Assert_return(new_parent >= 0);
+
+	m_nodes[new_parent].parent = old_parent;
+	bbox_combine(leaf_box, m_nodes[sibling].fat_box, m_nodes[new_parent].fat_box);
+	m_nodes[new_parent].categories = m_nodes[leaf].categories | m_nodes[sibling].categories;
+	m_nodes[new_parent].height = m_nodes[sibling].height + 1;
+	m_nodes[new_parent].child1 = sibling;
+	m_nodes[new_parent].child2 = leaf;
+	m_nodes[sibling].parent = new_parent;
+	m_nodes[leaf].parent = new_parent;
+
+	if (old_parent >= 0) {
+		if (m_nodes[old_parent].child1 == sibling) {
+			m_nodes[old_parent].child1 = new_parent;
+		} else {
+			m_nodes[old_parent].child2 = new_parent;
+		}
+	} else {
+		m_root = new_parent;
+	}
+
+	// refit and rebalance the ancestors.
+	index = m_nodes[leaf].parent;
+	while (index >= 0) {
+		index = balance(index);
+
+		aabb_tree_node &node = m_nodes[index];
+		node.height = 1 + MAX(m_nodes[node.child1].height, m_nodes[node.child2].height);
+		bbox_combine(m_nodes[node.child1].fat_box, m_nodes[node.child2].fat_box, node.fat_box);
+		node.categories = m_nodes[node.child1].categories | m_nodes[node.child2].categories;
+
+		index = node.parent;
+	}
+}
+
+void aabb_tree::remove_leaf(int leaf)
+{
+	if (leaf == m_root) {
+		m_root = -1;
+		return;
+	}
+
+	int parent = m_nodes[leaf].parent;
+	int grandparent = m_nodes[parent].parent;
+	int sibling = (m_nodes[parent].child1 == leaf) ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+	if (grandparent < 0) {
+		m_root = sibling;
+		m_nodes[sibling].parent = -1;
+		free_node(parent);
+		return;
+	}
+
+	// the sibling takes the parent's place.
+	if (m_nodes[grandparent].child1 == parent) {
+		m_nodes[grandparent].child1 = sibling;
+	} else {
+		m_nodes[grandparent].child2 = sibling;
+	}
+	m_nodes[sibling].parent = grandparent;
+	free_node(parent);
+
+	int index = grandparent;
+	while (index >= 0) {
+		index = balance(index);
+
+		aabb_tree_node &node = m_nodes[index];
+		node.height = 1 + MAX(m_nodes[node.child1].height, m_nodes[node.child2].height);
+		bbox_combine(m_nodes[node.child1].fat_box, m_nodes[node.child2].fat_box, node.fat_box);
+		node.categories = m_nodes[node.child1].categories | m_nodes[node.child2].categories;
+
+		index = node.parent;
+	}
+}
+
+// Rotate the deeper grandchild up if the node is out of balance.
+//
+// returns: the node now occupying this position in the tree.
+//
+int aabb_tree::balance(int index_a)
+{
+	aabb_tree_node &a = m_nodes[index_a];
+	if (a.is_leaf() || a.height < 2) {
+		return index_a;
+	}
+
+	int index_b = a.child1;
+	int index_c = a.child2;
+	aabb_tree_node &b = m_nodes[index_b];
+	aabb_tree_node &c = m_nodes[index_c];
+
+	int balance = c.height - b.height;
+
+	// rotate c up.
+	if (balance > 1) {
+		int index_f = c.child1;
+		int index_g = c.child2;
+		aabb_tree_node &f = m_nodes[index_f];
+		aabb_tree_node &g = m_nodes[index_g];
+
+		c.child1 = index_a;
+		c.parent = a.parent;
+		a.parent = index_c;
+
+		if (c.parent >= 0) {
+			if (m_nodes[c.parent].child1 == index_a) {
+				m_nodes[c.parent].child1 = index_c;
+			} else {
+				m_nodes[c.parent].child2 = index_c;
+			}
+		} else {
+			m_root = index_c;
+		}
+
+		if (f.height > g.height) {
+			c.child2 = index_f;
+			a.child2 = index_g;
+			g.parent = index_a;
+			bbox_combine(b.fat_box, g.fat_box, a.fat_box);
+			a.categories = b.categories | g.categories;
+			bbox_combine(a.fat_box, f.fat_box, c.fat_box);
+			c.categories = a.categories | f.categories;
+			a.height = 1 + MAX(b.height, g.height);
+			c.height = 1 + MAX(a.height, f.height);
+		} else {
+			c.child2 = index_g;
+			a.child2 = index_f;
+			f.parent = index_a;
+			bbox_combine(b.fat_box, f.fat_box, a.fat_box);
+			a.categories = b.categories | f.categories;
+			bbox_combine(a.fat_box, g.fat_box, c.fat_box);
+			c.categories = a.categories | g.categories;
+			a.height = 1 + MAX(b.height, f.height);
+			c.height = 1 + MAX(a.height, g.height);
+		}
+
+		return index_c;
+	}
+
+	// rotate b up.
+	if (balance < -1) {
+		int index_d = b.child1;
+		int index_e = b.child2;
+		aabb_tree_node &d = m_nodes[index_d];
+		aabb_tree_node &e = m_nodes[index_e];
+
+		b.child1 = index_a;
+		b.parent = a.parent;
+		a.parent = index_b;
+
+		if (b.parent >= 0) {
+			if (m_nodes[b.parent].child1 == index_a) {
+				m_nodes[b.parent].child1 = index_b;
+			} else {
+				m_nodes[b.parent].child2 = index_b;
+			}
+		} else {
+			m_root = index_b;
+		}
+
+		if (d.height > e.height) {
+			b.child2 = index_d;
+			a.child1 = index_e;
+			e.parent = index_a;
+			bbox_combine(c.fat_box, e.fat_box, a.fat_box);
+			a.categories = c.categories | e.categories;
+			bbox_combine(a.fat_box, d.fat_box, b.fat_box);
+			b.categories = a.categories | d.categories;
+			a.height = 1 + MAX(c.height, e.height);
+			b.height = 1 + MAX(a.height, d.height);
+		} else {
+			b.child2 = index_e;
+			a.child1 = index_d;
+			d.parent = index_a;
+			bbox_combine(c.fat_box, d.fat_box, a.fat_box);
+			a.categories = c.categories | d.categories;
+			bbox_combine(a.fat_box, e.fat_box, b.fat_box);
+			b.categories = a.categories | e.categories;
+			a.height = 1 + MAX(c.height, d.height);
+			b.height = 1 + MAX(a.height, e.height);
+		}
+
+		return index_b;
+	}
+
+	return index_a;
+}
+
+// Find all areas whose fat boxes overlap the given box.
+//
+// returns: number of handles written to handles_out.
+//
+int aabb_tree::query(const bbox_aligned &bounds, int *handles_out, int max_handles) const
+{
+	Assert_return_value(handles_out, 0);
+	if (m_root < 0) {
+		return 0;
+	}
+
+	int stack[AABB_TREE_STACK_SIZE];
+	int stack_size = 0;
+	stack[stack_size++] = m_root;
+
+	int num_found = 0;
+	while (stack_size > 0) {
+		const aabb_tree_node &node = m_nodes[stack[--stack_size]];
+		if (!bbox_overlap(node.fat_box, bounds)) {
+			continue;
+		}
+
+		if (node.is_leaf()) {
+			if (num_found >= max_handles) {
+				break;
+			}
+			handles_out[num_found++] = (int)(&node - m_nodes);
+		} else {
+			Assert_break(stack_size + 2 <= AABB_TREE_STACK_SIZE);
+			stack[stack_size++] = node.child1;
+			stack[stack_size++] = node.child2;
+		}
+	}
+
+	return num_found;
+}
+
+// Find all areas in the tree that actually collide with the given area.
+//
+// returns: number of handles written to handles_out.
+//
+int aabb_tree::query(const bounding_area &area, int *handles_out, int max_handles) const
+{
+	Assert_return_value(handles_out, 0);
+	if (m_root < 0) {
+		return 0;
+	}
+
+	bbox_aligned bounds;
+	bounding_area_get_bounds(area, bounds);
+
+	int stack[AABB_TREE_STACK_SIZE];
+	int stack_size = 0;
+	stack[stack_size++] = m_root;
+
+	int num_found = 0;
+	while (stack_size > 0) {
+		const aabb_tree_node &node = m_nodes[stack[--stack_size]];
+		if (!bbox_overlap(node.fat_box, bounds)) {
+			continue;
+		}
+
+		if (node.is_leaf()) {
+			if (node.area == &area || !area.collides(*node.area)) {
+				continue;
+			}
+			if (num_found >= max_handles) {
+				break;
+			}
+			handles_out[num_found++] = (int)(&node - m_nodes);
+		} else {
+			Assert_break(stack_size + 2 <= AABB_TREE_STACK_SIZE);
+			stack[stack_size++] = node.child1;
+			stack[stack_size++] = node.child2;
+		}
+	}
+
+	return num_found;
+}
+
+// Find the first area hit by the segment, starting from seg.a.
+//
+// hit_out: receives the point at which the segment first hits the area.
+//
+// returns: handle of the area hit, or -1 if nothing was hit.
+//
+int aabb_tree::raycast(const line_segment &seg, vector2 *hit_out /*= NULL*/) const
+{
+	if (m_root < 0) {
+		return -1;
+	}
+
+	// the segment is clipped to the closest hit so far, so nodes beyond it get culled.
+	line_segment clipped = seg;
+	int closest = -1;
+
+	int stack[AABB_TREE_STACK_SIZE];
+	int stack_size = 0;
+	stack[stack_size++] = m_root;
+
+	while (stack_size > 0) {
+		const aabb_tree_node &node = m_nodes[stack[--stack_size]];
+		if (!bbox_intersects_segment(node.fat_box, clipped)) {
+			continue;
+		}
+
+		if (node.is_leaf()) {
+			vector2 hit;
+			if (node.area->collides(clipped, &hit) > 0) {
+				closest = (int)(&node - m_nodes);
+				clipped.b = hit;
+			}
+		} else {
+			Assert_break(stack_size + 2 <= AABB_TREE_STACK_SIZE);
+			stack[stack_size++] = node.child1;
+			stack[stack_size++] = node.child2;
+		}
+	}
+
+	if (closest >= 0 && hit_out) {
+		*hit_out = clipped.b;
+	}
+	return closest;
+}
+
+int aabb_tree::gather_pairs(collision_pair *pairs_out, int max_pairs, bool narrowphase) const
+{
+	Assert_return_value(pairs_out, 0);
+	if (m_root < 0) {
+		return 0;
+	}
+
+	int stack[AABB_TREE_STACK_SIZE];
+	int num_pairs = 0;
+
+	for (int leaf = 0; leaf < m_max_nodes; leaf++) {
+		const aabb_tree_node &leaf_node = m_nodes[leaf];
+		if (leaf_node.height != 0) {
+			continue;
+		}
+
+		int stack_size = 0;
+		stack[stack_size++] = m_root;
+		while (stack_size > 0) {
+			int index = stack[--stack_size];
+			const aabb_tree_node &node = m_nodes[index];
+
+			// nothing down here that this leaf collides with.
+			if (!(node.categories & leaf_node.filter.mask)) {
+				continue;
+			}
+			if (!bbox_overlap(node.fat_box, leaf_node.fat_box)) {
+				continue;
+			}
+
+			if (node.is_leaf()) {
+				// each pair is visited from its lower handle.
+				if (index <= leaf) {
+					continue;
+				}
+				if (!collision_filter_passes(leaf_node.filter, node.filter)) {
+					continue;
+				}
+				if (narrowphase && !leaf_node.area->collides(*node.area)) {
+					continue;
+				}
+				if (num_pairs >= max_pairs) {
+					return num_pairs;
+				}
+				pairs_out[num_pairs].a = leaf;
+				pairs_out[num_pairs].b = index;
+				num_pairs++;
+			} else {
+				Assert_break(stack_size + 2 <= AABB_TREE_STACK_SIZE);
+				stack[stack_size++] = node.child1;
+				stack[stack_size++] = node.child2;
+			}
+		}
+	}
+
+	return num_pairs;
+}
+
+// Get every pair of areas whose fat boxes overlap.  Each pair is reported once.
+//
+// returns: number of pairs written to pairs_out.
+//
+int aabb_tree::get_candidate_pairs(collision_pair *pairs_out, int max_pairs) const
+{
+	return gather_pairs(pairs_out, max_pairs, false);
+}
+
+// Get every pair of areas that actually collide, running the candidate pairs
+// through bounding_area::collides.
+//
+// returns: number of pairs written to pairs_out.
+//
+int aabb_tree::get_colliding_pairs(collision_pair *pairs_out, int max_pairs) const
+{
+	return gather_pairs(pairs_out, max_pairs, true);
+}
@@ -0,0 +1,80 @@
+#ifndef __AABB_TREE_H
+#define __AABB_TREE_H
+
+#pragma once
+
+#include "bbox.h"
+
+// A dynamic bounding volume hierarchy of bbox_aligned nodes, balanced with tree
+// rotations as leaves are inserted and removed.
+//
+// Every leaf stores a "fat" box: the bounds of its area expanded by a margin and
+// stretched in the direction of travel.  Moving an area only costs a reinsert when
+// it leaves its fat box, so small movers rarely touch the tree, and huge static
+// geometry never does.
+//
+// Leaf node indices double as handles.  Node storage is allocated once up front.
+//
+// Each node also keeps the union of the filter categories below it, so a pair
+// search skips whole subtrees that hold nothing the leaf's mask accepts.
+//
+
+struct aabb_tree_node {
+	aabb_tree_node() : area(NULL), categories(0), parent(-1), child1(-1), child2(-1), height(-1) {}
+
+	bbox_aligned fat_box;
+	bounding_area *area;		// leaves only
+	collision_filter filter;	// leaves only
+	uint categories;			// every category in the subtree, so pair searches can skip it
+
+	int parent;					// next free node while in the free list
+	int child1;
+	int child2;
+
+	int height;					// 0 for leaves, -1 for free nodes
+
+	bool is_leaf() const {return child1 == -1;}
+};
+
+class aabb_tree {
+	private:
+		aabb_tree_node *m_nodes;
+		int m_max_nodes;
+		int m_first_free;
+		int m_root;
+		int m_num_leaves;
+		float m_margin;
+		float m_displacement_scale;
+
+		int alloc_node();
+		void free_node(int node);
+		void insert_leaf(int leaf);
+		void remove_leaf(int leaf);
+		int balance(int node);
+		void make_fat_box(const bounding_area &area, const vector2 &displacement, bbox_aligned &fat_box_out) const;
+		int gather_pairs(collision_pair *pairs_out, int max_pairs, bool narrowphase) const;
+
+	public:
+		aabb_tree(int max_objects, float margin, float displacement_scale = 2.0f);
+		~aabb_tree();
+
+		int add(bounding_area *area, const collision_filter &filter = collision_filter());
+		void remove(int handle);
+		bool move(int handle, const vector2 &delta);
+		bool update(int handle, const vector2 &displacement = ZERO_VECTOR);
+
+		bounding_area *get_area(int handle) const;
+		void set_filter(int handle, const collision_filter &filter);
+		collision_filter get_filter(int handle) const;
+		const bbox_aligned &get_fat_box(int handle) const;
+		int get_num_objects() const {return m_num_leaves;}
+		int get_height() const;
+
+		int query(const bbox_aligned &bounds, int *handles_out, int max_handles) const;
+		int query(const bounding_area &area, int *handles_out, int max_handles) const;
+		int raycast(const line_segment &seg, vector2 *hit_out = NULL) const;
+		int get_candidate_pairs(collision_pair *pairs_out, int max_pairs) const;
+		int get_colliding_pairs(collision_pair *pairs_out, int max_pairs) const;
+};
+
+#endif // __AABB_TREE_H
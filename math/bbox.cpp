@@ -16,140 +16,56 @@ inline void fl_min_max(float a, float b, float &min, float &max)
 	}
 }
 
-static bool bbox_overlap_aux(const vector2 corners1[4], const vector2 corners2[4], float box1_heading)
+// Separating axis theorem in 2d.  The only candidate axes are the boxes' own
+// rvecs and uvecs, so the boxes are projected onto those directly.
+//
+// offset: center of box 2 relative to the center of box 1.
+// half_r, half_u: each box's rvec and uvec scaled by half its width and height.
+//
+static bool oriented_overlap(const vector2 &offset, const matrix &orient1, const vector2 &half_r1, const vector2 &half_u1,
+	const matrix &orient2, const vector2 &half_r2, const vector2 &half_u2)
 {
-	vector2 b1_rot[4];
-	vector2 b2_rot[4];
-
-	for (uint i = 0; i < 4; i++) {
-		b1_rot[i] = corners1[i];
-		b2_rot[i] = corners2[i];
-
-		b1_rot[i].rotate(-1.0f * box1_heading);
-		b2_rot[i].rotate(-1.0f * box1_heading);
-	}
-
-	// Make certain that box 1 is now axis aligned.
-	Assert(fl_equals(b1_rot[0].y, b1_rot[1].y, 0.01f));
-	Assert(fl_equals(b1_rot[1].x, b1_rot[2].x, 0.01f));
-	Assert(fl_equals(b1_rot[2].y, b1_rot[3].y, 0.01f));
-	Assert(fl_equals(b1_rot[3].x, b1_rot[0].x, 0.01f));
-
-	vector2 b1_min(MIN(b1_rot[0].x, b1_rot[1].x), MIN(b1_rot[0].y, b1_rot[3].y));
-	vector2 b1_max(MAX(b1_rot[0].x, b1_rot[1].x), MAX(b1_rot[0].y, b1_rot[3].y));
+	const vector2 *axes[4] = {&orient1.rvec, &orient1.uvec, &orient2.rvec, &orient2.uvec};
+	for (int i = 0; i < 4; i++) {
+		const vector2 &axis = *axes[i];
 
-	vector2 b2_min = b2_rot[0];
-	vector2 b2_max = b2_rot[0];
+		float dist = fl_abs(offset.dot(axis));
+		float radius = fl_abs(half_r1.dot(axis)) + fl_abs(half_u1.dot(axis)) +
+			fl_abs(half_r2.dot(axis)) + fl_abs(half_u2.dot(axis));
 
-	// Find the extremities of the second box.
-	for (uint i = 1; i < 4; i++) {
-		if (b2_rot[i].x < b2_min.x) {
-			b2_min.x = b2_rot[i].x;
-		}
-		if (b2_rot[i].x > b2_max.x) {
-			b2_max.x = b2_rot[i].x;
-		}
-
-		if (b2_rot[i].y < b2_min.y) {
-			b2_min.y = b2_rot[i].y;
-		}
-		if (b2_rot[i].y > b2_max.y) {
-			b2_max.y = b2_rot[i].y;
+		// found a separating axis.
+		if (dist >= radius) {
+			return false;
 		}
 	}
 
-	// Check for overlap in the x axis.
-	bool x_overlaps = false;
-
-	if (b1_min.x > b2_min.x && b1_min.x < b2_max.x) {
-		x_overlaps = true;
-	}
-
-	if (!x_overlaps && b1_max.x > b2_min.x && b1_max.x < b2_max.x) {
-		x_overlaps = true;
-	}
-
-	if (!x_overlaps && b2_min.x > b1_min.x && b2_min.x < b1_max.x) {
-		x_overlaps = true;
-	}
-
-	if (!x_overlaps && b2_max.x > b1_min.x && b2_max.x < b1_max.x) {
-		x_overlaps = true;
-	}
-
-	// The x-axis is a separating axis.  No overlap!  Return false.
-	if (x_overlaps == false) {
-		return false;
-	}
-
-	bool y_overlaps = false;
-
-	if (b1_min.y > b2_min.y && b1_min.y < b2_max.y) {
-		y_overlaps = true;
-	}
-
-	if (!y_overlaps && b1_max.y > b2_min.y && b1_max.y < b2_max.y) {
-		y_overlaps = true;
-	}
-
-	if (!y_overlaps && b2_min.y > b1_min.y && b2_min.y < b1_max.y) {
-		y_overlaps = true;
-	}
-
-	if (!y_overlaps && b2_max.y > b1_min.y && b2_max.y < b1_max.y) {
-		y_overlaps = true;
-	}
-
-	// The y-axis is a separating axis.  No overlap!  Return false.
-	if (y_overlaps == false) {
-		return false;
-	}
+	/*no separating axis found,
+	the two boxes overlap */
 
-	// No separating axis was found, return true.
 	return true;
 }
 
-// Separating axis theorum in 2d.
+// Boxes that merely touch are not considered overlapping.
+//
 bool bbox_overlap(const bbox_oriented &bbox1, const bbox_oriented &bbox2)
 {
-	float heading1 = bbox1.orient.extract_heading();
-	float heading2 = bbox2.orient.extract_heading();
-
-	// copy in the locations of the corners starting at the bottom left
-	// and moving counter-clockwise.
-	vector2 box1_corners[4];
-	vector2 box2_corners[4];
-
-	vector2 box1_half_size = bbox1.size / 2;
-	vector2 box2_half_size = bbox2.size / 2;
+	vector2 offset = bbox2.center - bbox1.center;
 
-	box1_corners[0] = bbox1.center - (box1_half_size.x * bbox1.orient.rvec) - (box1_half_size.y * bbox1.orient.uvec);
-	box2_corners[0] = bbox2.center - (box2_half_size.x * bbox2.orient.rvec) - (box2_half_size.y * bbox2.orient.uvec);
-
-	box1_corners[1] = bbox1.center + (box1_half_size.x * bbox1.orient.rvec) - (box1_half_size.y * bbox1.orient.uvec);
-	box2_corners[1] = bbox2.center + (box2_half_size.x * bbox2.orient.rvec) - (box2_half_size.y * bbox2.orient.uvec);
-
-	box1_corners[2] = bbox1.center + (box1_half_size.x * bbox1.orient.rvec) + (box1_half_size.y * bbox1.orient.uvec);
-	box2_corners[2] = bbox2.center + (box2_half_size.x * bbox2.orient.rvec) + (box2_half_size.y * bbox2.orient.uvec);
-
-	box1_corners[3] = bbox1.center - (box1_half_size.x * bbox1.orient.rvec) + (box1_half_size.y * bbox1.orient.uvec);
-	box2_corners[3] = bbox2.center - (box2_half_size.x * bbox2.orient.rvec) + (box2_half_size.y * bbox2.orient.uvec);
-
-	bool found_separating_axis = !bbox_overlap_aux(box1_corners, box2_corners, heading1);
-	if (found_separating_axis) {
-		return false;
-	}
-
-	found_separating_axis = !bbox_overlap_aux(box2_corners, box1_corners, heading2);
-	if (found_separating_axis) {
-		return false;
+	// when both boxes are cached, their world bounds give a cheap early out.
+	if (bbox1.cache.valid && bbox2.cache.valid) {
+		if (fl_abs(offset.x) >= bbox1.cache.extent.x + bbox2.cache.extent.x) {
+			return false;
+		}
+		if (fl_abs(offset.y) >= bbox1.cache.extent.y + bbox2.cache.extent.y) {
+			return false;
+		}
 	}
 
-	/*no separating axis found,
-	the two boxes overlap */
-
-	return true;
+	vector2 half_r1, half_u1, half_r2, half_u2;
+	bbox1.get_extents(half_r1, half_u1);
+	bbox2.get_extents(half_r2, half_u2);
 
+	return oriented_overlap(offset, bbox1.orient, half_r1, half_u1, bbox2.orient, half_r2, half_u2);
 }
 
 bool bbox_overlap(const bbox_aligned &bbox1, const bbox_aligned &bbox2)
@@ -184,6 +100,79 @@ void bbox_convert_to_oriented(const bbox_aligned &source, bbox_oriented &dest)
 	dest.center = (source.bbmin + source.bbmax) * 0.5f;
 	dest.size = source.bbmax - source.bbmin;
 	dest.orient = IDENTITY_MATRIX;
+	dest.invalidate_cache();
+}
+
+// Get the world-space axis-aligned box that fully contains the area.
+//
+// area: shape of any bounding_area_type.
+// bounds_out: receives the enclosing box, with corrected corners.
+//
+void bounding_area_get_bounds(const bounding_area &area, bbox_aligned &bounds_out)
+{
+	vector2 center;
+	vector2 half_size;
+	matrix orient;
+
+	switch (area.get_type()) {
+		case BAT_BOX_ALIGNED:
+		{
+			const bbox_aligned &box = (const bbox_aligned &)(area);
+			bounds_out.bbmin = box.bbmin;
+			bounds_out.bbmax = box.bbmax;
+			bounds_out.correct_corners();
+			return;
+		}
+		case BAT_CIRCLE:
+		{
+			const bcircle &circle = (const bcircle &)(area);
+			vector2 radius(circle.radius, circle.radius);
+			bounds_out.bbmin = circle.center - radius;
+			bounds_out.bbmax = circle.center + radius;
+			return;
+		}
+		case BAT_BOX_ORIENTED:
+		{
+			const bbox_oriented &box = (const bbox_oriented &)(area);
+			if (box.cache.valid) {
+				bounds_out.bbmin = box.center - box.cache.extent;
+				bounds_out.bbmax = box.center + box.cache.extent;
+				return;
+			}
+			center = box.center;
+			half_size = box.size * 0.5f;
+			orient = box.orient;
+			break;
+		}
+		case BAT_UNIFIED:
+		{
+			const bounding_area_unified &uni = (const bounding_area_unified &)(area);
+			if (uni.inner_type == BAT_CIRCLE) {
+				vector2 radius(uni.size.x, uni.size.x);
+				bounds_out.bbmin = uni.center - radius;
+				bounds_out.bbmax = uni.center + radius;
+				return;
+			}
+			Assert(uni.inner_type == BAT_BOX_ORIENTED);
+			center = uni.center;
+			half_size = uni.size * 0.5f;
+			orient = uni.orient;
+			break;
+		}
+		default:
+		{
+			Assert(0);
+			bounds_out.bbmin = bounds_out.bbmax = area.get_center();
+			return;
+		}
+	}
+
+	// Project the box's half-extents onto the world axes.
+	vector2 extent;
+	extent.x = fl_abs(orient.rvec.x * half_size.x) + fl_abs(orient.uvec.x * half_size.y);
+	extent.y = fl_abs(orient.rvec.y * half_size.x) + fl_abs(orient.uvec.y * half_size.y);
+	bounds_out.bbmin = center - extent;
+	bounds_out.bbmax = center + extent;
 }
 
 bool bbox_overlap(const bbox_oriented &o_box, const bbox_aligned &a_box)
@@ -209,17 +198,12 @@ bool bbox_intersects_point(const bbox_aligned &bbox, const vector2 &pt)
 	return true;
 }
 
-bool bbox_intersects_circle(const bbox_aligned &bbox, const bcircle &circle)
+// Circle against an axis-aligned box, given as raw corners.
+//
+static bool aligned_intersects_circle(const vector2 &bbmin, const vector2 &bbmax, const vector2 &center, float radius)
 {
-	float radius = circle.radius;
-	vector2 center = circle.center;
-
-	// make sure the min and max are correct.
-	Assert(bbox.bbmin.x <= bbox.bbmax.x);
-	Assert(bbox.bbmin.y <= bbox.bbmax.y);
-
 	// check if the point is inside the box
-	if (bbox_intersects_point(bbox, center)) {
+	if (center.x <= bbmax.x && center.x >= bbmin.x && center.y <= bbmax.y && center.y >= bbmin.y) {
 		return true;
 	}
 
@@ -227,75 +211,55 @@ bool bbox_intersects_circle(const bbox_aligned &bbox, const bcircle &circle)
 	float radius_sq = SQUARED(radius);
 
 	// if it's beyond the bottom left
-	if (center.x < bbox.bbmin.x && center.y < bbox.bbmin.y) {
-		if (center.dist_squared(bbox.bbmin) < radius_sq) {
-			return true;
-		} else {
-			return false;
-		}
+	if (center.x < bbmin.x && center.y < bbmin.y) {
+		return center.dist_squared(bbmin) < radius_sq;
 	}
 
 	// if it's beyond the top right
-	if (center.x > bbox.bbmax.x && center.y > bbox.bbmax.y) {
-		if (center.dist_squared(bbox.bbmax) < radius_sq) {
-			return true;
-		} else {
-			return false;
-		}
+	if (center.x > bbmax.x && center.y > bbmax.y) {
+		return center.dist_squared(bbmax) < radius_sq;
 	}
 
-	vector2 top_left(bbox.bbmin.x, bbox.bbmax.y), bottom_right(bbox.bbmax.x, bbox.bbmin.y);
-
 	// if it's beyond the top left
-	if (center.x < top_left.x && center.y > top_left.y) {
-		if (center.dist_squared(top_left) < radius_sq) {
-			return true;
-		} else {
-			return false;
-		}
+	if (center.x < bbmin.x && center.y > bbmax.y) {
+		return center.dist_squared(vector2(bbmin.x, bbmax.y)) < radius_sq;
 	}
 
 	// if it's beyond the bottom right
-	if (center.x > bottom_right.x && center.y < bottom_right.y) {
-		if (center.dist_squared(bottom_right) < radius_sq) {
-			return true;
-		} else {
-			return false;
-		}
+	if (center.x > bbmax.x && center.y < bbmin.y) {
+		return center.dist_squared(vector2(bbmax.x, bbmin.y)) < radius_sq;
 	}
 
 	// not inside, not touching a corner, check the sides.
 	// second check for a basic separating axis (cicle touching edge)
-	bbox_aligned circle_box;
-	circle_box.bbmin.x = center.x - radius;
-	circle_box.bbmax.x = center.x + radius;
-	circle_box.bbmin.y = center.y - radius;
-	circle_box.bbmax.y = center.y + radius;
-	if (bbox_overlap(circle_box, bbox)) {
-		return true;
+	float abs_radius = fl_abs(radius);
+	if (center.x + abs_radius < bbmin.x || bbmax.x < center.x - abs_radius) {
+		return false;
+	}
+	if (center.y + abs_radius < bbmin.y || bbmax.y < center.y - abs_radius) {
+		return false;
 	}
 
-	// not inside, not touching an edge, not touching a corner, must be outside.
-	return false;
+	return true;
 }
 
-bool bbox_intersects_circle(const bbox_oriented &bbox, const bcircle &circle)
+bool bbox_intersects_circle(const bbox_aligned &bbox, const bcircle &circle)
 {
-	bcircle transformed_circle;
-
-	// translate so the box center is relatively zero.
-	transformed_circle.center = circle.center - bbox.center;
-	transformed_circle.radius = circle.radius;
+	// make sure the min and max are correct.
+	Assert(bbox.bbmin.x <= bbox.bbmax.x);
+	Assert(bbox.bbmin.y <= bbox.bbmax.y);
 
-	// unrotate according to the box.
-	float box_heading = bbox.orient.extract_heading();
-	transformed_circle.center.rotate(-1.0f * box_heading);
+	return aligned_intersects_circle(bbox.bbmin, bbox.bbmax, circle.center, circle.radius);
+}
 
-	bbox_aligned aabb;
-	aabb.bbmax = bbox.size * 0.5f;
-	aabb.bbmin = -aabb.bbmax;
+bool bbox_intersects_circle(const bbox_oriented &bbox, const bcircle &circle)
+{
+	// move the circle into the box's space.
+	vector2 local_center;
+	world_to_local(circle.center, bbox.center, bbox.orient, local_center);
 
-	return bbox_intersects_circle(aabb, transformed_circle);
+	vector2 half_size = bbox.size * 0.5f;
+	return aligned_intersects_circle(-half_size, half_size, local_center, circle.radius);
 }
 
 bool lines_coincide(const line &a, const line &b)
@@ -583,6 +547,51 @@ bool bbox_intersects_ray(const bbox_oriented &bbox, const line &ray)
 	return false;
 }
 
+// Slab test of a segment against an axis-aligned box.
+//
+// t_enter_out: fraction along the segment (0 at a, 1 at b) at which it enters
+// the box.  Zero if the segment starts inside.
+//
+bool bbox_intersects_segment(const bbox_aligned &bbox, const line_segment &seg, float *t_enter_out /*= NULL*/)
+{
+	vector2 delta = seg.b - seg.a;
+	float t_min = 0.0f;
+	float t_max = 1.0f;
+
+	for (int axis = 0; axis < 2; axis++) {
+		float start = axis == 0 ? seg.a.x : seg.a.y;
+		float dir = axis == 0 ? delta.x : delta.y;
+		float slab_min = axis == 0 ? bbox.bbmin.x : bbox.bbmin.y;
+		float slab_max = axis == 0 ? bbox.bbmax.x : bbox.bbmax.y;
+
+		if (dir == 0.0f) {
+			// parallel to the slab, so it has to start within it.
+			if (start < slab_min || start > slab_max) {
+				return false;
+			}
+			continue;
+		}
+
+		float inv_dir = 1.0f / dir;
+		float t1 = (slab_min - start) * inv_dir;
+		float t2 = (slab_max - start) * inv_dir;
+		if (t1 > t2) {
+			SWAP(t1, t2, float);
+		}
+
+		t_min = MAX(t_min, t1);
+		t_max = MIN(t_max, t2);
+		if (t_min > t_max) {
+			return false;
+		}
+	}
+
+	if (t_enter_out) {
+		*t_enter_out = t_min;
+	}
+	return true;
+}
+
 bool circle_overlap(const bcircle &circle1, const bcircle &circle2)
 {
 	if (circle1.radius == 0 || circle2.radius == 0) {
@@ -593,6 +602,146 @@ bool circle_overlap(const bcircle &circle1, const bcircle &circle2)
 	return mag_sq < SQUARED(circle1.radius + circle2.radius);
 }
 
+// Shape against shape tests for bounding_shape_collides.  Each one matches the
+// bounding_area test for the same pair of types.
+//
+static bool shape_aligned_vs_aligned(const bounding_shape &a, const bounding_shape &b)
+{
+	vector2 offset = b.center - a.center;
+	return fl_abs(offset.x) <= (a.size.x + b.size.x) * 0.5f && fl_abs(offset.y) <= (a.size.y + b.size.y) * 0.5f;
+}
+
+static bool shape_box_vs_box(const bounding_shape &a, const bounding_shape &b)
+{
+	return oriented_overlap(b.center - a.center,
+		a.orient, a.orient.rvec * (a.size.x * 0.5f), a.orient.uvec * (a.size.y * 0.5f),
+		b.orient, b.orient.rvec * (b.size.x * 0.5f), b.orient.uvec * (b.size.y * 0.5f));
+}
+
+static bool shape_box_vs_circle(const bounding_shape &box, const bounding_shape &circle)
+{
+	vector2 local_center;
+	world_to_local(circle.center, box.center, box.orient, local_center);
+
+	vector2 half_size = box.size * 0.5f;
+	return aligned_intersects_circle(-half_size, half_size, local_center, circle.size.x);
+}
+
+static bool shape_circle_vs_box(const bounding_shape &circle, const bounding_shape &box)
+{
+	return shape_box_vs_circle(box, circle);
+}
+
+static bool shape_circle_vs_circle(const bounding_shape &a, const bounding_shape &b)
+{
+	if (a.size.x == 0 || b.size.x == 0) {
+		return false;
+	}
+
+	return a.center.dist_squared(b.center) < SQUARED(a.size.x + b.size.x);
+}
+
+// Indexed by the types of the two shapes.  Unified areas always resolve to their
+// inner type, so they never reach the table.
+static const bounding_shape_collide_func Bounding_shape_collide_table[BAT_NUM_TYPES][BAT_NUM_TYPES] = {
+	//					BAT_BOX_ALIGNED				BAT_BOX_ORIENTED		BAT_CIRCLE				BAT_UNIFIED
+	/* BAT_BOX_ALIGNED */	{shape_aligned_vs_aligned,	shape_box_vs_box,		shape_box_vs_circle,	NULL},
+	/* BAT_BOX_ORIENTED */	{shape_box_vs_box,			shape_box_vs_box,		shape_box_vs_circle,	NULL},
+	/* BAT_CIRCLE */		{shape_circle_vs_box,		shape_circle_vs_box,	shape_circle_vs_circle,	NULL},
+	/* BAT_UNIFIED */		{NULL,						NULL,					NULL,					NULL},
+};
+
+// Collide two shapes with a single table lookup, rather than a virtual call
+// followed by a switch on the other area's type.
+//
+bool bounding_shape_collides(const bounding_shape &a, const bounding_shape &b)
+{
+	Assert_return_value(a.type >= 0 && a.type < BAT_NUM_TYPES, false);
+	Assert_return_value(b.type >= 0 && b.type < BAT_NUM_TYPES, false);
+
+	bounding_shape_collide_func func = Bounding_shape_collide_table[a.type][b.type];
+	Assert_return_value(func, false);
+
+	return func(a, b);
+}
+
+// Collide a batch of pairs, rejecting filtered pairs before touching their shapes.
+//
+// shapes: shapes indexed by the handles in the pairs.
+// filters: filters indexed the same way.  May be NULL to skip filtering.
+//
+// returns: number of colliding pairs written to colliding_out, in pair order.
+//
+int bounding_shape_collide_pairs(const bounding_shape *shapes, const collision_filter *filters, const collision_pair *pairs, int num_pairs,
+	collision_pair *colliding_out, int max_colliding)
+{
+	Assert_return_value(shapes && pairs && colliding_out, 0);
+
+	int num_colliding = 0;
+	for (int i = 0; i < num_pairs; i++) {
+		const collision_pair &pair = pairs[i];
+		if (filters && !collision_filter_passes(filters[pair.a], filters[pair.b])) {
+			continue;
+		}
+		if (!bounding_shape_collides(shapes[pair.a], shapes[pair.b])) {
+			continue;
+		}
+
+		if (num_colliding >= max_colliding) {
+			break;
+		}
+		colliding_out[num_colliding++] = pair;
+	}
+
+	return num_colliding;
+}
+
+bool bounding_area::collides(const bounding_area &area) const
+{
+	bounding_shape shape_a, shape_b;
+	get_shape(shape_a);
+	area.get_shape(shape_b);
+
+	return bounding_shape_collides(shape_a, shape_b);
+}
+
+void bbox_aligned::get_shape(bounding_shape &shape_out) const
+{
+	shape_out.type = BAT_BOX_ALIGNED;
+	shape_out.center = (bbmin + bbmax) * 0.5f;
+
+	// the corners may not have been corrected yet.
+	shape_out.size.x = fl_abs(bbmax.x - bbmin.x);
+	shape_out.size.y = fl_abs(bbmax.y - bbmin.y);
+	shape_out.orient = IDENTITY_MATRIX;
+}
+
+void bbox_oriented::get_shape(bounding_shape &shape_out) const
+{
+	shape_out.type = BAT_BOX_ORIENTED;
+	shape_out.center = center;
+	shape_out.size = size;
+	shape_out.orient = orient;
+}
+
+void bcircle::get_shape(bounding_shape &shape_out) const
+{
+	shape_out.type = BAT_CIRCLE;
+	shape_out.center = center;
+	shape_out.size.x = shape_out.size.y = radius;
+	shape_out.orient = orient;
+}
+
+void bounding_area_unified::get_shape(bounding_shape &shape_out) const
+{
+	Assert(inner_type == BAT_BOX_ORIENTED || inner_type == BAT_CIRCLE);
+
+	shape_out.type = inner_type;
+	shape_out.center = center;
+	shape_out.size = size;
+	shape_out.orient = orient;
+}
+
 void bbox_aligned::move(const vector2 &delta)
 {
 	bbmin += delta;
@@ -643,49 +792,67 @@ int bbox_aligned::collides(const line_segment &seg, vector2 *first_hit_out/* = N
 	return box.collides(seg, first_hit_out, second_hit_out);
 }
 
-bool bbox_aligned::collides(const bounding_area &area) const
+void bbox_oriented::move(const vector2 &delta)
 {
-	switch (area.get_type()) {
-		case BAT_CIRCLE:
-		{
-			const bcircle &circle = (const bcircle &)(area);
-			return bbox_intersects_circle(*this, circle);
-		}
-		case BAT_BOX_ORIENTED:
-		{
-			const bbox_oriented &box = (const bbox_oriented &)(area);
-			return bbox_overlap(box, *this);
-		}
-		case BAT_BOX_ALIGNED:
-		{
-			bbox_aligned &box = (bbox_aligned &)(area);
-			box.correct_corners();
-			return bbox_overlap(*this, box);
-		}
-		case BAT_UNIFIED:
-		{
-			const bounding_area_unified *uni = (const bounding_area_unified*)&area;
-			if (uni->inner_type == BAT_BOX_ORIENTED) {
-				bbox_oriented bbox;
-				bbox.copy(uni);
-				return bbox_overlap(bbox, *this);
-			} else if (uni->inner_type == BAT_CIRCLE) {
-				bcircle circle;
-				circle.copy(uni);
-				return bbox_intersects_circle(*this, circle);
-			}
-		}
-		default:
-		{
-			Assert(0);
-			return false;
+	center += delta;
+
+	// translation doesn't change the extents, so the cache only needs its corners moved.
+	if (cache.valid) {
+		for (int i = 0; i < 4; i++) {
+			cache.corners[i] += delta;
 		}
 	}
 }
 
-void bbox_oriented::move(const vector2 &delta)
+// Compute and store the box's world-space extents and corners, so repeated tests
+// against it skip the work.
+//
+void bbox_oriented::cache_extents() const
 {
-	center += delta;
+	cache.half_rvec = orient.rvec * (size.x * 0.5f);
+	cache.half_uvec = orient.uvec * (size.y * 0.5f);
+
+	cache.extent.x = fl_abs(cache.half_rvec.x) + fl_abs(cache.half_uvec.x);
+	cache.extent.y = fl_abs(cache.half_rvec.y) + fl_abs(cache.half_uvec.y);
+
+	cache.corners[0] = center - cache.half_rvec - cache.half_uvec;
+	cache.corners[1] = center + cache.half_rvec - cache.half_uvec;
+	cache.corners[2] = center + cache.half_rvec + cache.half_uvec;
+	cache.corners[3] = center - cache.half_rvec + cache.half_uvec;
+
+	cache.valid = true;
+}
+
+// Get the rvec and uvec scaled to half the box's width and height.
+//
+void bbox_oriented::get_extents(vector2 &half_rvec_out, vector2 &half_uvec_out) const
+{
+	if (cache.valid) {
+		half_rvec_out = cache.half_rvec;
+		half_uvec_out = cache.half_uvec;
+	} else {
+		half_rvec_out = orient.rvec * (size.x * 0.5f);
+		half_uvec_out = orient.uvec * (size.y * 0.5f);
+	}
+}
+
+// Get the world-space corners, counter-clockwise from the bottom left.
+//
+void bbox_oriented::get_corners(vector2 corners_out[4]) const
+{
+	if (cache.valid) {
+		for (int i = 0; i < 4; i++) {
+			corners_out[i] = cache.corners[i];
+		}
+		return;
+	}
+
+	vector2 half_rvec, half_uvec;
+	get_extents(half_rvec, half_uvec);
+	corners_out[0] = center - half_rvec - half_uvec;
+	corners_out[1] = center + half_rvec - half_uvec;
+	corners_out[2] = center + half_rvec + half_uvec;
+	corners_out[3] = center - half_rvec + half_uvec;
 }
 
 void bbox_oriented::copy(const bounding_area *src)
@@ -697,6 +864,7 @@ void bbox_oriented::copy(const bounding_area *src)
 		center = uni->center;
 		size = uni->size;
 		orient = uni->orient;
+		invalidate_cache();
 	} else {
 		Assert_return(src->get_type() == BAT_BOX_ALIGNED || src->get_type() == BAT_BOX_ORIENTED);
 		if (src->get_type() == BAT_BOX_ALIGNED) {
@@ -787,46 +955,6 @@ int bbox_oriented::collides(const line_segment &seg, vector2 *first_hit_out /* =
 	}
 }
 
-bool bbox_oriented::collides(const bounding_area &area) const
-{
-	switch (area.get_type()) {
-		case BAT_CIRCLE:
-		{
-			const bcircle &circle = (const bcircle &)(area);
-			return bbox_intersects_circle(*this, circle);
-		}
-		case BAT_BOX_ORIENTED:
-		{
-			const bbox_oriented &box = (const bbox_oriented &)(area);
-			return bbox_overlap(*this, box);
-		}
-		case BAT_BOX_ALIGNED:
-		{
-			bbox_aligned &box = (bbox_aligned &)(area);
-			box.correct_corners();
-			return bbox_overlap(*this, box);
-		}
-		case BAT_UNIFIED:
-		{
-			const bounding_area_unified *uni = (const bounding_area_unified*)&area;
-			if (uni->inner_type == BAT_BOX_ORIENTED) {
-				bbox_oriented bbox;
-				bbox.copy(uni);
-				return bbox_overlap(bbox, *this);
-			} else if (uni->inner_type == BAT_CIRCLE) {
-				bcircle circle;
-				circle.copy(uni);
-				return bbox_intersects_circle(*this, circle);
-			}
-		}
-		default:
-		{
-			Assert(0);
-			return false;
-		}
-	}
-}
-
 void bcircle::move(const vector2 &delta)
 {
 	center += delta;
@@ -847,50 +975,53 @@ void bcircle::copy(const bounding_area *src)
 	}
 }
 
+// Find where the segment crosses the edge of the circle.  As with the boxes, a
+// segment that lies entirely inside the circle doesn't cross it.
+//
+// returns: number of crossings (0-2).  The first hit is the one closer to seg.a.
+//
 int bcircle::collides(const line_segment &seg, vector2 *first_hit_out /* = NULL */, vector2 *second_hit_out /* = NULL */) const
 {
-	// todo - not yet implemented!
-	return 0;
-}
+	vector2 dir = seg.b - seg.a;
+	vector2 from_center = seg.a - center;
 
-bool bcircle::collides(const bounding_area &area) const
-{
-	switch (area.get_type()) {
-		case BAT_CIRCLE:
-		{
-			const bcircle &circle = (const bcircle &)(area);
-			return circle_overlap(*this, circle);
-		}
-		case BAT_BOX_ORIENTED:
-		{
-			const bbox_oriented &box = (const bbox_oriented &)(area);
-			return bbox_intersects_circle(box, *this);
-		}
-		case BAT_BOX_ALIGNED:
-		{
-			bbox_aligned &box = (bbox_aligned &)(area);
-			box.correct_corners();
-			return bbox_intersects_circle(box, *this);
-		}
-		case BAT_UNIFIED:
-		{
-			const bounding_area_unified *uni = (const bounding_area_unified*)&area;
-			if (uni->inner_type == BAT_BOX_ORIENTED) {
-				bbox_oriented bbox;
-				bbox.copy(uni);
-				return bbox_intersects_circle(bbox, *this);
-			} else if (uni->inner_type == BAT_CIRCLE) {
-				bcircle circle;
-				circle.copy(uni);
-				return circle_overlap(circle, *this);
-			}
-		}
-		default:
-		{
-			Assert(0);
-			return false;
-		}
+	// solve |a + t*dir - center|^2 = radius^2 for t.
+	float qa = dir.dot(dir);
+	float qb = from_center.dot(dir);
+	float qc = from_center.dot(from_center) - SQUARED(radius);
+
+	if (qa == 0.0f) {
+		return 0;
 	}
+
+	float discriminant = SQUARED(qb) - (qa * qc);
+	if (discriminant < 0.0f) {
+		return 0;
+	}
+
+	float root = sqrtf(discriminant);
+	float t1 = (-qb - root) / qa;
+	float t2 = (-qb + root) / qa;
+
+	vector2 hits[2];
+	int num_hits = 0;
+	if (t1 >= 0.0f && t1 <= 1.0f) {
+		hits[num_hits++] = seg.a + (dir * t1);
+	}
+
+	// a tangent line only touches once.
+	if (t2 >= 0.0f && t2 <= 1.0f && discriminant > 0.0f) {
+		hits[num_hits++] = seg.a + (dir * t2);
+	}
+
+	if (num_hits >= 1 && first_hit_out) {
+		*first_hit_out = hits[0];
+	}
+	if (num_hits >= 2 && second_hit_out) {
+		*second_hit_out = hits[1];
+	}
+
+	return num_hits;
 }
 
 void bbox_aligned::copy(const bbox_aligned &source)
@@ -934,6 +1065,7 @@ void bbox_oriented::copy(const bbox_oriented &source)
 	center = source.center;
 	size = source.size;
 	orient = source.orient;
+	invalidate_cache();
 }
 
 void bbox_oriented::copy(const bbox_aligned &source)
@@ -1038,26 +1170,6 @@ int bounding_area_unified::collides( const line_segment &seg, vector2 *first_hit
 	return new_area->collides(seg, first_hit_out, second_hit_out);
 }
 
-bool bounding_area_unified::collides( const bounding_area &area ) const
-{
-	bounding_area *my_area = NULL;
-	bcircle circ;
-	bbox_oriented bbo;
-	if (inner_type == BAT_CIRCLE) {
-		circ.copy(this);
-		my_area = &circ;
-	} else if (inner_type == BAT_BOX_ORIENTED) {
-		bbo.copy(this);
-		my_area = &bbo;
-	} else {
-		Assert_return_value(!"Unhandled shape in bounding_area_unified::collides", false);
-	}
-
-	Assert_return_value(my_area, false);
-
-	return my_area->collides(area);
-}
-
 void bounding_area_unified::scale( const vector2 & size_delta, float min_size /*= 1.0f*/ )
 {
 	size += size_delta;
@@ -33,14 +33,62 @@ struct line_segment {
 	vector2 b;
 };
 
+// A pair of handles reported by a broadphase as potentially colliding.
+// The lower handle is always stored in a.
+//
+struct collision_pair {
+	int a;
+	int b;
+};
+
+#define COLLISION_CATEGORY_DEFAULT		(0x00000001u)
+#define COLLISION_CATEGORY_ALL			(0xFFFFFFFFu)
+
+// Which pairs of shapes gameplay cares about.  Each shape belongs to one or more
+// categories, and only collides with shapes in the categories in its mask.  The
+// broadphases check filters before looking at any geometry.
+//
+struct collision_filter {
+	collision_filter() : category(COLLISION_CATEGORY_DEFAULT), mask(COLLISION_CATEGORY_ALL) {}
+	collision_filter(uint _category, uint _mask) : category(_category), mask(_mask) {}
+
+	uint category;
+	uint mask;
+};
+
+inline bool collision_filter_passes(const collision_filter &a, const collision_filter &b)
+{
+	return (a.category & b.mask) && (b.category & a.mask);
+}
+
+// Plain-data description of any bounding area, with no vtable, so shapes can be
+// stored contiguously and collided through bounding_shape_collides without
+// virtual calls.
+//
+// Boxes store their full size.  Circles store their radius in size.x, the same
+// as bounding_area_unified.  Aligned boxes are stored by center and size with an
+// identity orientation.
+//
+struct bounding_shape {
+	bounding_shape() : type(BAT_INVALID), center(ZERO_VECTOR), size(ZERO_VECTOR), orient(IDENTITY_MATRIX) {}
+
+	bounding_area_type type;		// BAT_BOX_ALIGNED, BAT_BOX_ORIENTED or BAT_CIRCLE.
+	vector2 center;
+	vector2 size;
+	matrix orient;
+};
+
+typedef bool (*bounding_shape_collide_func)(const bounding_shape &a, const bounding_shape &b);
+
 struct bounding_area {
-	virtual bool collides(const bounding_area &area) const = 0;
+	virtual bool collides(const bounding_area &area) const;
 	virtual bounding_area_type get_type() const = 0;
 	virtual vector2 get_center() const = 0;
 	virtual int collides(const line_segment &seg, vector2 *first_hit_out = NULL, vector2 *second_hit_out = NULL) const = 0;
 	virtual void move(const vector2 &delta) = 0;
 	virtual void copy(const bounding_area *src) = 0;
 	virtual void get_orient(matrix &orient_out) const = 0;
+	virtual void get_shape(bounding_shape &shape_out) const = 0;
 };
 
 struct bbox_aligned : public bounding_area {
@@ -54,18 +102,31 @@ struct bbox_aligned : public bounding_area {
 	vector2 bbmin;
 	vector2 bbmax;
 
-	virtual bool collides(const bounding_area &area) const;
+	using bounding_area::collides;
 	virtual int collides(const line_segment &seg, vector2 *first_hit_out = NULL, vector2 *second_hit_out = NULL) const;
 	virtual bounding_area_type get_type() const {return BAT_BOX_ALIGNED;}
 	virtual vector2 get_center() const {return (bbmin + bbmax) * 0.5f;}
 	virtual void move(const vector2 &delta);
 	virtual void copy(const bounding_area *src);
 	virtual void get_orient(matrix &orient_out) const {orient_out = IDENTITY_MATRIX;}
+	virtual void get_shape(bounding_shape &shape_out) const;
 	void copy(const bbox_aligned &source);
 	void correct_corners();
 	void expand( vector2 pos );
 };
 
+// World-space values derived from a bbox_oriented, so boxes that are tested many
+// times in a frame only pay for them once.
+struct bbox_oriented_cache {
+	bbox_oriented_cache() : valid(false) {}
+
+	vector2 half_rvec;		// rvec scaled by half the width.
+	vector2 half_uvec;		// uvec scaled by half the height.
+	vector2 extent;			// half-size of the world-aligned bounds.
+	vector2 corners[4];		// counter-clockwise from the bottom left.
+	bool valid;
+};
+
 struct bbox_oriented : public bounding_area {
 
 	bbox_oriented *prev, *next;
@@ -80,16 +141,27 @@ struct bbox_oriented : public bounding_area {
 	vector2 size;
 	matrix orient;
 
-	virtual bool collides(const bounding_area &area) const;
+	// Optional.  Filled in by cache_extents(), kept up to date by move(), and
+	// cleared by copy().  Call invalidate_cache() after writing center, size or
+	// orient directly.
+	mutable bbox_oriented_cache cache;
+
+	using bounding_area::collides;
 	virtual int collides(const line_segment &seg, vector2 *first_hit_out = NULL, vector2 *second_hit_out = NULL) const;
 	virtual bounding_area_type get_type() const {return BAT_BOX_ORIENTED;}
 	virtual vector2 get_center() const {return center;}
 	virtual void move(const vector2 &delta);
 	virtual void copy(const bounding_area *src);
 	virtual void get_orient(matrix &orient_out) const {orient_out = orient;}
+	virtual void get_shape(bounding_shape &shape_out) const;
 
 	void copy(const bbox_aligned &source);
 	void copy(const bbox_oriented &source);
+
+	void cache_extents() const;
+	void invalidate_cache() {cache.valid = false;}
+	void get_extents(vector2 &half_rvec_out, vector2 &half_uvec_out) const;
+	void get_corners(vector2 corners_out[4]) const;
 };
 
 struct bcircle : public bounding_area {
@@ -106,13 +178,14 @@ struct bcircle : public bounding_area {
 	float radius;
 	matrix orient;
 
-	virtual bool collides(const bounding_area &area) const;
+	using bounding_area::collides;
 	virtual int collides(const line_segment &seg, vector2 *first_hit_out = NULL, vector2 *second_hit_out = NULL) const;
 	virtual bounding_area_type get_type() const {return BAT_CIRCLE;}
 	virtual vector2 get_center() const {return center;}
 	virtual void move(const vector2 &delta);
 	virtual void copy(const bounding_area *src);
 	virtual void get_orient(matrix &orient_out) const {orient_out = orient;}
+	virtual void get_shape(bounding_shape &shape_out) const;
 
 	void copy(const bcircle &source);
 };
@@ -128,13 +201,14 @@ struct bounding_area_unified : public bounding_area {
 	vector2 size;
 	matrix orient;
 
-	virtual bool collides(const bounding_area &area) const;
+	using bounding_area::collides;
 	virtual int collides(const line_segment &seg, vector2 *first_hit_out = NULL, vector2 *second_hit_out = NULL) const;
 	virtual bounding_area_type get_type() const {return BAT_UNIFIED;}
 	virtual vector2 get_center() const {return center;}
 	virtual void move(const vector2 &delta) {center += delta;}
 	virtual void copy(const bounding_area *src);
 	virtual void get_orient(matrix &orient_out) const {orient_out = orient;}
+	virtual void get_shape(bounding_shape &shape_out) const;
 	void scale( const vector2 & size_delta, float min_size = 1.0f );
 };
 
@@ -146,11 +220,17 @@ bool segment_intersects_segment(const line_segment &_a, const line_segment &_b,
 bool line_intersects_line(const line &_a, const line &_b, vector2 *ix_point_out = NULL);
 bool lines_coincide(const line &_a, const line &b);
 bool bbox_intersects_ray(const bbox_oriented &bbox, const line &ray);
+bool bbox_intersects_segment(const bbox_aligned &bbox, const line_segment &seg, float *t_enter_out = NULL);
 bool bbox_overlap(const bbox_aligned &bbox1, const bbox_aligned &bbox2);
 bool bbox_overlap(const bbox_oriented &bbox1, const bbox_oriented &bbox2);
 bool bbox_overlap(const bbox_oriented &o_box, const bbox_aligned &a_box);
 bool circle_overlap(const bcircle &circle1, const bcircle &circle2);
 
+bool bounding_shape_collides(const bounding_shape &a, const bounding_shape &b);
+int bounding_shape_collide_pairs(const bounding_shape *shapes, const collision_filter *filters, const collision_pair *pairs, int num_pairs,
+	collision_pair *colliding_out, int max_colliding);
+
 void bbox_convert_to_oriented(const bbox_aligned &source, bbox_oriented &dest);
+void bounding_area_get_bounds(const bounding_area &area, bbox_aligned &bounds_out);
 
 #endif // __BBOX_H
\ No newline at end of file
@@ -0,0 +1,454 @@
+#include "bbox_batch.h"
+
+#include <cstring>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// returns: index of the lowest set bit.  bits must not be 0.
+//
+static inline int bbox_batch_lowest_bit(uint bits)
+{
+#if defined(__GNUC__)
+	return __builtin_ctz(bits);
+#elif defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, bits);
+	return (int)index;
+#else
+	int index = 0;
+	while (!(bits & 1)) {
+		bits >>= 1;
+		index++;
+	}
+	return index;
+#endif
+}
+
+bbox_oriented_soa::bbox_oriented_soa(int max_boxes)
+{
+	Assert(max_boxes > 0);
+	max_count = MAX(max_boxes, 1);
+	count = 0;
+
+	center_x = new float[max_count];
+	center_y = new float[max_count];
+	half_x = new float[max_count];
+	half_y = new float[max_count];
+	rvec_x = new float[max_count];
+	rvec_y = new float[max_count];
+	uvec_x = new float[max_count];
+	uvec_y = new float[max_count];
+}
+
+bbox_oriented_soa::~bbox_oriented_soa()
+{
+	delete [] center_x;
+	delete [] center_y;
+	delete [] half_x;
+	delete [] half_y;
+	delete [] rvec_x;
+	delete [] rvec_y;
+	delete [] uvec_x;
+	delete [] uvec_y;
+}
+
+// Append a box to the arrays.
+//
+// returns: index of the box, or -1 if the arrays are full.
+//
+int bbox_oriented_soa::add(const bbox_oriented &box)
+{
+	Assert_return_value(count < max_count, -1);
+	count++;
+	set(count - 1, box);
+	return count - 1;
+}
+
+void bbox_oriented_soa::set(int index, const bbox_oriented &box)
+{
+	Assert_return(index >= 0 && index < count);
+
+	center_x[index] = box.center.x;
+	center_y[index] = box.center.y;
+	half_x[index] = fl_abs(box.size.x) * 0.5f;
+	half_y[index] = fl_abs(box.size.y) * 0.5f;
+	rvec_x[index] = box.orient.rvec.x;
+	rvec_y[index] = box.orient.rvec.y;
+	uvec_x[index] = box.orient.uvec.x;
+	uvec_y[index] = box.orient.uvec.y;
+}
+
+bcircle_soa::bcircle_soa(int max_circles)
+{
+	Assert(max_circles > 0);
+	max_count = MAX(max_circles, 1);
+	count = 0;
+
+	center_x = new float[max_count];
+	center_y = new float[max_count];
+	radius = new float[max_count];
+}
+
+bcircle_soa::~bcircle_soa()
+{
+	delete [] center_x;
+	delete [] center_y;
+	delete [] radius;
+}
+
+// Append a circle to the arrays.
+//
+// returns: index of the circle, or -1 if the arrays are full.
+//
+int bcircle_soa::add(const bcircle &circle)
+{
+	Assert_return_value(count < max_count, -1);
+	count++;
+	set(count - 1, circle);
+	return count - 1;
+}
+
+void bcircle_soa::set(int index, const bcircle &circle)
+{
+	Assert_return(index >= 0 && index < count);
+
+	center_x[index] = circle.center.x;
+	center_y[index] = circle.center.y;
+	radius[index] = circle.radius;
+}
+
+// The query box, pulled apart the same way as the targets.
+struct bbox_batch_query {
+	float center_x, center_y;
+	float half_x, half_y;
+	float rvec_x, rvec_y;
+	float uvec_x, uvec_y;
+};
+
+// Separating axis test using the four box axes directly, with no trig.  Boxes
+// that only touch are not considered overlapping, matching bbox_overlap.
+//
+static inline bool bbox_batch_overlap_one(const bbox_batch_query &q, const bbox_oriented_soa &boxes, int i)
+{
+	float tx = boxes.center_x[i] - q.center_x;
+	float ty = boxes.center_y[i] - q.center_y;
+
+	// cosines between the two boxes' axes.
+	float rr = fl_abs(boxes.rvec_x[i] * q.rvec_x + boxes.rvec_y[i] * q.rvec_y);
+	float ur = fl_abs(boxes.uvec_x[i] * q.rvec_x + boxes.uvec_y[i] * q.rvec_y);
+	float ru = fl_abs(boxes.rvec_x[i] * q.uvec_x + boxes.rvec_y[i] * q.uvec_y);
+	float uu = fl_abs(boxes.uvec_x[i] * q.uvec_x + boxes.uvec_y[i] * q.uvec_y);
+
+	float hx = boxes.half_x[i];
+	float hy = boxes.half_y[i];
+
+	// the query's axes.
+	if (fl_abs(tx * q.rvec_x + ty * q.rvec_y) >= q.half_x + hx * rr + hy * ur) {
+		return false;
+	}
+	if (fl_abs(tx * q.uvec_x + ty * q.uvec_y) >= q.half_y + hx * ru + hy * uu) {
+		return false;
+	}
+
+	// the target's axes.
+	if (fl_abs(tx * boxes.rvec_x[i] + ty * boxes.rvec_y[i]) >= hx + q.half_x * rr + q.half_y * ru) {
+		return false;
+	}
+	if (fl_abs(tx * boxes.uvec_x[i] + ty * boxes.uvec_y[i]) >= hy + q.half_x * ur + q.half_y * uu) {
+		return false;
+	}
+
+	return true;
+}
+
+#if defined(__AVX__)
+
+#define BBOX_BATCH_WIDTH		(8)
+
+inline __m256 bbox_batch_abs(__m256 v)
+{
+	return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v);
+}
+
+// Test eight boxes at once.
+//
+// returns: one bit per box, set if it overlaps the query.
+//
+static inline uint bbox_batch_overlap_wide(const bbox_batch_query &q, const bbox_oriented_soa &boxes, int i)
+{
+	__m256 q_rx = _mm256_set1_ps(q.rvec_x);
+	__m256 q_ry = _mm256_set1_ps(q.rvec_y);
+	__m256 q_ux = _mm256_set1_ps(q.uvec_x);
+	__m256 q_uy = _mm256_set1_ps(q.uvec_y);
+	__m256 q_hx = _mm256_set1_ps(q.half_x);
+	__m256 q_hy = _mm256_set1_ps(q.half_y);
+
+	__m256 b_rx = _mm256_loadu_ps(boxes.rvec_x + i);
+	__m256 b_ry = _mm256_loadu_ps(boxes.rvec_y + i);
+	__m256 b_ux = _mm256_loadu_ps(boxes.uvec_x + i);
+	__m256 b_uy = _mm256_loadu_ps(boxes.uvec_y + i);
+	__m256 b_hx = _mm256_loadu_ps(boxes.half_x + i);
+	__m256 b_hy = _mm256_loadu_ps(boxes.half_y + i);
+
+	__m256 tx = _mm256_sub_ps(_mm256_loadu_ps(boxes.center_x + i), _mm256_set1_ps(q.center_x));
+	__m256 ty = _mm256_sub_ps(_mm256_loadu_ps(boxes.center_y + i), _mm256_set1_ps(q.center_y));
+
+	__m256 rr = bbox_batch_abs(_mm256_add_ps(_mm256_mul_ps(b_rx, q_rx), _mm256_mul_ps(b_ry, q_ry)));
+	__m256 ur = bbox_batch_abs(_mm256_add_ps(_mm256_mul_ps(b_ux, q_rx), _mm256_mul_ps(b_uy, q_ry)));
+	__m256 ru = bbox_batch_abs(_mm256_add_ps(_mm256_mul_ps(b_rx, q_ux), _mm256_mul_ps(b_ry, q_uy)));
+	__m256 uu = bbox_batch_abs(_mm256_add_ps(_mm256_mul_ps(b_ux, q_ux), _mm256_mul_ps(b_uy, q_uy)));
+
+	__m256 dist, radius, overlaps;
+
+	dist = bbox_batch_abs(_mm256_add_ps(_mm256_mul_ps(tx, q_rx), _mm256_mul_ps(ty, q_ry)));
+	radius = _mm256_add_ps(q_hx, _mm256_add_ps(_mm256_mul_ps(b_hx, rr), _mm256_mul_ps(b_hy, ur)));
+	overlaps = _mm256_cmp_ps(dist, radius, _CMP_LT_OQ);
+
+	dist = bbox_batch_abs(_mm256_add_ps(_mm256_mul_ps(tx, q_ux), _mm256_mul_ps(ty, q_uy)));
+	radius = _mm256_add_ps(q_hy, _mm256_add_ps(_mm256_mul_ps(b_hx, ru), _mm256_mul_ps(b_hy, uu)));
+	overlaps = _mm256_and_ps(overlaps, _mm256_cmp_ps(dist, radius, _CMP_LT_OQ));
+
+	dist = bbox_batch_abs(_mm256_add_ps(_mm256_mul_ps(tx, b_rx), _mm256_mul_ps(ty, b_ry)));
+	radius = _mm256_add_ps(b_hx, _mm256_add_ps(_mm256_mul_ps(q_hx, rr), _mm256_mul_ps(q_hy, ru)));
+	overlaps = _mm256_and_ps(overlaps, _mm256_cmp_ps(dist, radius, _CMP_LT_OQ));
+
+	dist = bbox_batch_abs(_mm256_add_ps(_mm256_mul_ps(tx, b_ux), _mm256_mul_ps(ty, b_uy)));
+	radius = _mm256_add_ps(b_hy, _mm256_add_ps(_mm256_mul_ps(q_hx, ur), _mm256_mul_ps(q_hy, uu)));
+	overlaps = _mm256_and_ps(overlaps, _mm256_cmp_ps(dist, radius, _CMP_LT_OQ));
+
+	return (uint)_mm256_movemask_ps(overlaps);
+}
+
+#elif defined(__SSE__)
+
+#define BBOX_BATCH_WIDTH		(4)
+
+inline __m128 bbox_batch_abs(__m128 v)
+{
+	return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+}
+
+// Test four boxes at once.
+//
+// returns: one bit per box, set if it overlaps the query.
+//
+static inline uint bbox_batch_overlap_wide(const bbox_batch_query &q, const bbox_oriented_soa &boxes, int i)
+{
+	__m128 q_rx = _mm_set1_ps(q.rvec_x);
+	__m128 q_ry = _mm_set1_ps(q.rvec_y);
+	__m128 q_ux = _mm_set1_ps(q.uvec_x);
+	__m128 q_uy = _mm_set1_ps(q.uvec_y);
+	__m128 q_hx = _mm_set1_ps(q.half_x);
+	__m128 q_hy = _mm_set1_ps(q.half_y);
+
+	__m128 b_rx = _mm_loadu_ps(boxes.rvec_x + i);
+	__m128 b_ry = _mm_loadu_ps(boxes.rvec_y + i);
+	__m128 b_ux = _mm_loadu_ps(boxes.uvec_x + i);
+	__m128 b_uy = _mm_loadu_ps(boxes.uvec_y + i);
+	__m128 b_hx = _mm_loadu_ps(boxes.half_x + i);
+	__m128 b_hy = _mm_loadu_ps(boxes.half_y + i);
+
+	__m128 tx = _mm_sub_ps(_mm_loadu_ps(boxes.center_x + i), _mm_set1_ps(q.center_x));
+	__m128 ty = _mm_sub_ps(_mm_loadu_ps(boxes.center_y + i), _mm_set1_ps(q.center_y));
+
+	__m128 rr = bbox_batch_abs(_mm_add_ps(_mm_mul_ps(b_rx, q_rx), _mm_mul_ps(b_ry, q_ry)));
+	__m128 ur = bbox_batch_abs(_mm_add_ps(_mm_mul_ps(b_ux, q_rx), _mm_mul_ps(b_uy, q_ry)));
+	__m128 ru = bbox_batch_abs(_mm_add_ps(_mm_mul_ps(b_rx, q_ux), _mm_mul_ps(b_ry, q_uy)));
+	__m128 uu = bbox_batch_abs(_mm_add_ps(_mm_mul_ps(b_ux, q_ux), _mm_mul_ps(b_uy, q_uy)));
+
+	__m128 dist, radius, overlaps;
+
+	dist = bbox_batch_abs(_mm_add_ps(_mm_mul_ps(tx, q_rx), _mm_mul_ps(ty, q_ry)));
+	radius = _mm_add_ps(q_hx, _mm_add_ps(_mm_mul_ps(b_hx, rr), _mm_mul_ps(b_hy, ur)));
+	overlaps = _mm_cmplt_ps(dist, radius);
+
+	dist = bbox_batch_abs(_mm_add_ps(_mm_mul_ps(tx, q_ux), _mm_mul_ps(ty, q_uy)));
+	radius = _mm_add_ps(q_hy, _mm_add_ps(_mm_mul_ps(b_hx, ru), _mm_mul_ps(b_hy, uu)));
+	overlaps = _mm_and_ps(overlaps, _mm_cmplt_ps(dist, radius));
+
+	dist = bbox_batch_abs(_mm_add_ps(_mm_mul_ps(tx, b_rx), _mm_mul_ps(ty, b_ry)));
+	radius = _mm_add_ps(b_hx, _mm_add_ps(_mm_mul_ps(q_hx, rr), _mm_mul_ps(q_hy, ru)));
+	overlaps = _mm_and_ps(overlaps, _mm_cmplt_ps(dist, radius));
+
+	dist = bbox_batch_abs(_mm_add_ps(_mm_mul_ps(tx, b_ux), _mm_mul_ps(ty, b_uy)));
+	radius = _mm_add_ps(b_hy, _mm_add_ps(_mm_mul_ps(q_hx, ur), _mm_mul_ps(q_hy, uu)));
+	overlaps = _mm_and_ps(overlaps, _mm_cmplt_ps(dist, radius));
+
+	return (uint)_mm_movemask_ps(overlaps);
+}
+
+#endif
+
+// Test one oriented box against every box in the arrays.
+//
+// mask_out: receives one bit per box, set if it overlaps the query.  Must hold
+// BBOX_BATCH_MASK_WORDS(boxes.count) words.
+//
+void bbox_overlap_batch_mask(const bbox_oriented &query, const bbox_oriented_soa &boxes, uint *mask_out)
+{
+	Assert_return(mask_out);
+	memset(mask_out, 0, sizeof(uint) * BBOX_BATCH_MASK_WORDS(boxes.count));
+
+	bbox_batch_query q;
+	q.center_x = query.center.x;
+	q.center_y = query.center.y;
+	q.half_x = fl_abs(query.size.x) * 0.5f;
+	q.half_y = fl_abs(query.size.y) * 0.5f;
+	q.rvec_x = query.orient.rvec.x;
+	q.rvec_y = query.orient.rvec.y;
+	q.uvec_x = query.orient.uvec.x;
+	q.uvec_y = query.orient.uvec.y;
+
+	int i = 0;
+
+#ifdef BBOX_BATCH_WIDTH
+	// groups start on a multiple of their width, so they never straddle a mask word.
+	for (; i + BBOX_BATCH_WIDTH <= boxes.count; i += BBOX_BATCH_WIDTH) {
+		mask_out[i / 32] |= bbox_batch_overlap_wide(q, boxes, i) << (i % 32);
+	}
+#endif
+
+	for (; i < boxes.count; i++) {
+		if (bbox_batch_overlap_one(q, boxes, i)) {
+			mask_out[i / 32] |= 1u << (i % 32);
+		}
+	}
+}
+
+// Test one oriented box against every box in the arrays.
+//
+// hits_out: receives the indices of the overlapping boxes in ascending order.
+// Must have room for boxes.count entries.
+//
+// returns: number of overlapping boxes.
+//
+int bbox_overlap_batch(const bbox_oriented &query, const bbox_oriented_soa &boxes, int *hits_out)
+{
+	Assert_return_value(hits_out, 0);
+
+	// small batches keep the mask on the stack.
+	int num_words = BBOX_BATCH_MASK_WORDS(boxes.count);
+	uint mask_stack[64];
+	uint *mask = num_words <= 64 ? mask_stack : new uint[num_words];
+
+	bbox_overlap_batch_mask(query, boxes, mask);
+
+	int num_hits = 0;
+	for (int word = 0; word < num_words; word++) {
+		uint bits = mask[word];
+		while (bits) {
+			int bit = bbox_batch_lowest_bit(bits);
+			hits_out[num_hits++] = word * 32 + bit;
+			bits &= bits - 1;
+		}
+	}
+
+	if (mask != mask_stack) {
+		delete [] mask;
+	}
+	return num_hits;
+}
+
+// Cast a segment against every circle and box in the arrays, and find the first
+// one it hits.  A shape containing seg.a is hit at t = 0.
+//
+// circles: circles to test against.  May be NULL.
+// boxes: oriented boxes to test against.  May be NULL.
+// hit_out: receives the nearest hit, if any.
+//
+// returns: true if anything was hit.
+//
+bool segment_cast_batch(const line_segment &seg, const bcircle_soa *circles, const bbox_oriented_soa *boxes, raycast_hit &hit_out)
+{
+	float dir_x = seg.b.x - seg.a.x;
+	float dir_y = seg.b.y - seg.a.y;
+	float dir_sq = SQUARED(dir_x) + SQUARED(dir_y);
+
+	// anything beyond the end of the segment is a miss.
+	float best_t = 2.0f;
+	int best_index = -1;
+	bounding_area_type best_type = BAT_INVALID;
+
+	if (circles && dir_sq > 0.0f) {
+		float inv_dir_sq = 1.0f / dir_sq;
+		for (int i = 0; i < circles->count; i++) {
+			float fx = seg.a.x - circles->center_x[i];
+			float fy = seg.a.y - circles->center_y[i];
+			float qb = (fx * dir_x) + (fy * dir_y);
+			float qc = (fx * fx) + (fy * fy) - SQUARED(circles->radius[i]);
+			float discriminant = SQUARED(qb) - (dir_sq * qc);
+
+			// entry point, clamped to the start if we begin inside the circle.
+			float t = (-qb - sqrtf(MAX(discriminant, 0.0f))) * inv_dir_sq;
+			t = (qc <= 0.0f) ? 0.0f : t;
+
+			bool hit = (qc <= 0.0f) || (discriminant >= 0.0f && t >= 0.0f);
+			if (hit && t < best_t) {
+				best_t = t;
+				best_index = i;
+				best_type = BAT_CIRCLE;
+			}
+		}
+	}
+
+	if (boxes) {
+		for (int i = 0; i < boxes->count; i++) {
+			// move the segment into the box's space, then clip it against both slabs.
+			float fx = seg.a.x - boxes->center_x[i];
+			float fy = seg.a.y - boxes->center_y[i];
+
+			float start_r = (fx * boxes->rvec_x[i]) + (fy * boxes->rvec_y[i]);
+			float start_u = (fx * boxes->uvec_x[i]) + (fy * boxes->uvec_y[i]);
+			float dir_r = (dir_x * boxes->rvec_x[i]) + (dir_y * boxes->rvec_y[i]);
+			float dir_u = (dir_x * boxes->uvec_x[i]) + (dir_y * boxes->uvec_y[i]);
+
+			float t_min = 0.0f;
+			float t_max = 1.0f;
+			bool hit = true;
+
+			if (dir_r == 0.0f) {
+				hit = fl_abs(start_r) <= boxes->half_x[i];
+			} else {
+				float inv_dir = 1.0f / dir_r;
+				float t1 = (-boxes->half_x[i] - start_r) * inv_dir;
+				float t2 = (boxes->half_x[i] - start_r) * inv_dir;
+				t_min = MAX(t_min, MIN(t1, t2));
+				t_max = MIN(t_max, MAX(t1, t2));
+			}
+
+			if (dir_u == 0.0f) {
+				hit = hit && fl_abs(start_u) <= boxes->half_y[i];
+			} else {
+				float inv_dir = 1.0f / dir_u;
+				float t1 = (-boxes->half_y[i] - start_u) * inv_dir;
+				float t2 = (boxes->half_y[i] - start_u) * inv_dir;
+				t_min = MAX(t_min, MIN(t1, t2));
+				t_max = MIN(t_max, MAX(t1, t2));
+			}
+
+			if (hit && t_min <= t_max && t_min < best_t) {
+				best_t = t_min;
+				best_index = i;
+				best_type = BAT_BOX_ORIENTED;
+			}
+		}
+	}
+
+	if (best_index < 0 || best_t > 1.0f) {
+		return false;
+	}
+
+	hit_out.t = best_t;
+	hit_out.point = vector2(seg.a.x + (dir_x * best_t), seg.a.y + (dir_y * best_t));
+	hit_out.index = best_index;
+	hit_out.type = best_type;
+	return true;
+}
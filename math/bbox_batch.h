@@ -0,0 +1,71 @@
+#ifndef __BBOX_BATCH_H
+#define __BBOX_BATCH_H
+
+#pragma once
+
+#include "bbox.h"
+
+// Batched collision tests against shapes stored as a structure of arrays, so a
+// single query shape can be tested against many targets with SIMD.
+//
+// The kernels use SSE when the compiler targets it (and AVX when that is
+// enabled as well), and fall back to plain loops everywhere else.
+//
+
+// Oriented boxes split into one array per component.  Axes are expected to be
+// unit length and perpendicular, as they are in a bbox_oriented.
+struct bbox_oriented_soa {
+	bbox_oriented_soa(int max_boxes);
+	~bbox_oriented_soa();
+
+	float *center_x;
+	float *center_y;
+	float *half_x;
+	float *half_y;
+	float *rvec_x;
+	float *rvec_y;
+	float *uvec_x;
+	float *uvec_y;
+
+	int count;
+	int max_count;
+
+	int add(const bbox_oriented &box);
+	void set(int index, const bbox_oriented &box);
+	void clear() {count = 0;}
+};
+
+// Circles split into one array per component.
+struct bcircle_soa {
+	bcircle_soa(int max_circles);
+	~bcircle_soa();
+
+	float *center_x;
+	float *center_y;
+	float *radius;
+
+	int count;
+	int max_count;
+
+	int add(const bcircle &circle);
+	void set(int index, const bcircle &circle);
+	void clear() {count = 0;}
+};
+
+// The nearest shape hit by a segment cast.
+struct raycast_hit {
+	raycast_hit() : t(1.0f), point(ZERO_VECTOR), index(-1), type(BAT_INVALID) {}
+
+	float t;						// fraction along the segment, 0 at a and 1 at b.
+	vector2 point;
+	int index;						// index into the array of the shape hit.
+	bounding_area_type type;		// BAT_CIRCLE or BAT_BOX_ORIENTED.
+};
+
+#define BBOX_BATCH_MASK_WORDS(count)		(((count) + 31) / 32)
+
+void bbox_overlap_batch_mask(const bbox_oriented &query, const bbox_oriented_soa &boxes, uint *mask_out);
+int bbox_overlap_batch(const bbox_oriented &query, const bbox_oriented_soa &boxes, int *hits_out);
+bool segment_cast_batch(const line_segment &seg, const bcircle_soa *circles, const bbox_oriented_soa *boxes, raycast_hit &hit_out);
+
+#endif // __BBOX_BATCH_H
@@ -0,0 +1,337 @@
+#include "broadphase_grid.h"
+
+// Large primes used to scatter cell coordinates across the buckets.
+#define GRID_HASH_PRIME_X		(73856093u)
+#define GRID_HASH_PRIME_Y		(19349663u)
+
+inline int grid_cell_coord(float val, float inv_cell_size)
+{
+	return fl2i(fl_floor(val * inv_cell_size));
+}
+
+// cell_size: width and height of a single grid cell in world units.
+// max_objects: maximum number of bounding areas tracked at once.
+// max_entries: maximum number of (object, cell) records across all objects.
+// num_buckets: number of hash buckets the cells are distributed into.
+//
+broadphase_grid::broadphase_grid(float cell_size, int max_objects, int max_entries, int num_buckets)
+{
+	Assert(cell_size > 0.0f);
+	Assert(max_objects > 0);
+
+	m_cell_size = MAX(cell_size, 0.001f);
+	m_inv_cell_size = 1.0f / m_cell_size;
+
+	m_max_objects = MAX(max_objects, 1);
+	m_objects = new broadphase_grid_object[m_max_objects];
+	m_num_objects = 0;
+
+	// chain up the free handles.
+	for (int i = 0; i < m_max_objects - 1; i++) {
+		m_objects[i].next_free = i + 1;
+	}
+	m_objects[m_max_objects - 1].next_free = -1;
+	m_first_free = 0;
+
+	m_entries = new static_pool<broadphase_grid_entry>(MAX(max_entries, 1), MAX(num_buckets, 1));
+}
+
+broadphase_grid::~broadphase_grid()
+{
+	if (m_objects) {
+		delete [] m_objects;
+	}
+	if (m_entries) {
+		delete m_entries;
+	}
+}
+
+int broadphase_grid::get_bucket(int cell_x, int cell_y) const
+{
+	uint hash = ((uint)cell_x * GRID_HASH_PRIME_X) ^ ((uint)cell_y * GRID_HASH_PRIME_Y);
+	return (int)(hash % (uint)m_entries->num_used_lists);
+}
+
+void broadphase_grid::add_entry(int handle, int cell_x, int cell_y)
+{
+	broadphase_grid_entry *entry = m_entries->alloc(get_bucket(cell_x, cell_y));
+
+	// out of entries--the object will be missing from this cell.
+	Assert_return(entry);
+
+	entry->handle = handle;
+	entry->cell_x = cell_x;
+	entry->cell_y = cell_y;
+}
+
+void broadphase_grid::remove_entry(int handle, int cell_x, int cell_y)
+{
+	int bucket = get_bucket(cell_x, cell_y);
+	broadphase_grid_entry *entry = NULL;
+	DL_FOREACH(m_entries->used_lists[bucket], entry) {
+		if (entry->handle == handle && entry->cell_x == cell_x && entry->cell_y == cell_y) {
+			m_entries->free(entry, bucket);
+			return;
+		}
+	}
+}
+
+// Refresh the cached bounds of the object from its bounding area.
+//
+void broadphase_grid::update_bounds(broadphase_grid_object &obj)
+{
+	bbox_aligned bounds;
+	bounding_area_get_bounds(*obj.area, bounds);
+	obj.bbmin = bounds.bbmin;
+	obj.bbmax = bounds.bbmax;
+}
+
+// Start tracking a bounding area.  The grid does not take ownership of the area,
+// which must remain valid until it is removed.
+//
+// filter: pairs this filter rejects are never reported.
+//
+// returns: handle used to refer to the area, or -1 if the grid is full.
+//
+int broadphase_grid::add(bounding_area *area, const collision_filter &filter /*= collision_filter()*/)
+{
+	Assert_return_value(area, -1);
+	Assert_return_value(m_first_free >= 0, -1);
+
+	int handle = m_first_free;
+	broadphase_grid_object &obj = m_objects[handle];
+	m_first_free = obj.next_free;
+	m_num_objects++;
+
+	obj.area = area;
+	obj.filter = filter;
+	obj.next_free = -1;
+	update_bounds(obj);
+
+	obj.cell_min_x = grid_cell_coord(obj.bbmin.x, m_inv_cell_size);
+	obj.cell_min_y = grid_cell_coord(obj.bbmin.y, m_inv_cell_size);
+	obj.cell_max_x = grid_cell_coord(obj.bbmax.x, m_inv_cell_size);
+	obj.cell_max_y = grid_cell_coord(obj.bbmax.y, m_inv_cell_size);
+
+	for (int y = obj.cell_min_y; y <= obj.cell_max_y; y++) {
+		for (int x = obj.cell_min_x; x <= obj.cell_max_x; x++) {
+			add_entry(handle, x, y);
+		}
+	}
+
+	return handle;
+}
+
+void broadphase_grid::remove(int handle)
+{
+	Assert_return(handle >= 0 && handle < m_max_objects);
+	broadphase_grid_object &obj = m_objects[handle];
+	Assert_return(obj.area);
+
+	for (int y = obj.cell_min_y; y <= obj.cell_max_y; y++) {
+		for (int x = obj.cell_min_x; x <= obj.cell_max_x; x++) {
+			remove_entry(handle, x, y);
+		}
+	}
+
+	obj.area = NULL;
+	obj.cell_max_x = obj.cell_min_x - 1;
+	obj.cell_max_y = obj.cell_min_y - 1;
+	obj.next_free = m_first_free;
+	m_first_free = handle;
+	m_num_objects--;
+}
+
+// Move the tracked area and update the grid to match.
+//
+void broadphase_grid::move(int handle, const vector2 &delta)
+{
+	Assert_return(handle >= 0 && handle < m_max_objects);
+	Assert_return(m_objects[handle].area);
+
+	m_objects[handle].area->move(delta);
+	update(handle);
+}
+
+// Re-bucket an area after it has been moved or resized externally.  Only the
+// cells the area has entered or left are touched.
+//
+void broadphase_grid::update(int handle)
+{
+	Assert_return(handle >= 0 && handle < m_max_objects);
+	broadphase_grid_object &obj = m_objects[handle];
+	Assert_return(obj.area);
+
+	update_bounds(obj);
+
+	int new_min_x = grid_cell_coord(obj.bbmin.x, m_inv_cell_size);
+	int new_min_y = grid_cell_coord(obj.bbmin.y, m_inv_cell_size);
+	int new_max_x = grid_cell_coord(obj.bbmax.x, m_inv_cell_size);
+	int new_max_y = grid_cell_coord(obj.bbmax.y, m_inv_cell_size);
+
+	// most moves stay within the same cells.
+	if (new_min_x == obj.cell_min_x && new_min_y == obj.cell_min_y && new_max_x == obj.cell_max_x && new_max_y == obj.cell_max_y) {
+		return;
+	}
+
+	// leave the cells that are no longer covered.
+	for (int y = obj.cell_min_y; y <= obj.cell_max_y; y++) {
+		for (int x = obj.cell_min_x; x <= obj.cell_max_x; x++) {
+			if (x < new_min_x || x > new_max_x || y < new_min_y || y > new_max_y) {
+				remove_entry(handle, x, y);
+			}
+		}
+	}
+
+	// enter the newly covered ones.
+	for (int y = new_min_y; y <= new_max_y; y++) {
+		for (int x = new_min_x; x <= new_max_x; x++) {
+			if (x < obj.cell_min_x || x > obj.cell_max_x || y < obj.cell_min_y || y > obj.cell_max_y) {
+				add_entry(handle, x, y);
+			}
+		}
+	}
+
+	obj.cell_min_x = new_min_x;
+	obj.cell_min_y = new_min_y;
+	obj.cell_max_x = new_max_x;
+	obj.cell_max_y = new_max_y;
+}
+
+bounding_area *broadphase_grid::get_area(int handle) const
+{
+	Assert_return_value(handle >= 0 && handle < m_max_objects, NULL);
+	return m_objects[handle].area;
+}
+
+// Change which pairs are reported for an area.  Takes effect on the next query for pairs.
+//
+void broadphase_grid::set_filter(int handle, const collision_filter &filter)
+{
+	Assert_return(handle >= 0 && handle < m_max_objects);
+	Assert_return(m_objects[handle].area);
+	m_objects[handle].filter = filter;
+}
+
+collision_filter broadphase_grid::get_filter(int handle) const
+{
+	Assert_return_value(handle >= 0 && handle < m_max_objects, collision_filter());
+	return m_objects[handle].filter;
+}
+
+// Find all areas whose bounds overlap the given box.
+//
+// returns: number of handles written to handles_out.
+//
+int broadphase_grid::query(const bbox_aligned &bounds, int *handles_out, int max_handles) const
+{
+	Assert_return_value(handles_out, 0);
+
+	int min_x = grid_cell_coord(MIN(bounds.bbmin.x, bounds.bbmax.x), m_inv_cell_size);
+	int min_y = grid_cell_coord(MIN(bounds.bbmin.y, bounds.bbmax.y), m_inv_cell_size);
+	int max_x = grid_cell_coord(MAX(bounds.bbmin.x, bounds.bbmax.x), m_inv_cell_size);
+	int max_y = grid_cell_coord(MAX(bounds.bbmin.y, bounds.bbmax.y), m_inv_cell_size);
+
+	int num_found = 0;
+	for (int y = min_y; y <= max_y; y++) {
+		for (int x = min_x; x <= max_x; x++) {
+			broadphase_grid_entry *entry = NULL;
+			DL_FOREACH(m_entries->used_lists[get_bucket(x, y)], entry) {
+				if (entry->cell_x != x || entry->cell_y != y) {
+					continue;
+				}
+
+				// only report an object from the first cell it shares with the query.
+				const broadphase_grid_object &obj = m_objects[entry->handle];
+				if (x != MAX(obj.cell_min_x, min_x) || y != MAX(obj.cell_min_y, min_y)) {
+					continue;
+				}
+
+				bbox_aligned obj_bounds(obj.bbmin, obj.bbmax);
+				if (!bbox_overlap(obj_bounds, bounds)) {
+					continue;
+				}
+
+				if (num_found >= max_handles) {
+					return num_found;
+				}
+				handles_out[num_found++] = entry->handle;
+			}
+		}
+	}
+
+	return num_found;
+}
+
+int broadphase_grid::gather_pairs(collision_pair *pairs_out, int max_pairs, bool narrowphase) const
+{
+	Assert_return_value(pairs_out, 0);
+
+	int num_pairs = 0;
+	for (int handle = 0; handle < m_max_objects; handle++) {
+		const broadphase_grid_object &obj = m_objects[handle];
+		if (obj.area == NULL) {
+			continue;
+		}
+
+		for (int y = obj.cell_min_y; y <= obj.cell_max_y; y++) {
+			for (int x = obj.cell_min_x; x <= obj.cell_max_x; x++) {
+				broadphase_grid_entry *entry = NULL;
+				DL_FOREACH(m_entries->used_lists[get_bucket(x, y)], entry) {
+					// each pair is visited from its lower handle.
+					if (entry->handle <= handle || entry->cell_x != x || entry->cell_y != y) {
+						continue;
+					}
+
+					const broadphase_grid_object &other = m_objects[entry->handle];
+					if (!collision_filter_passes(obj.filter, other.filter)) {
+						continue;
+					}
+
+					// objects can share several cells--only report the pair from the
+					// lowest shared one.
+					if (x != MAX(obj.cell_min_x, other.cell_min_x) || y != MAX(obj.cell_min_y, other.cell_min_y)) {
+						continue;
+					}
+
+					if (obj.bbmax.x < other.bbmin.x || other.bbmax.x < obj.bbmin.x ||
+						obj.bbmax.y < other.bbmin.y || other.bbmax.y < obj.bbmin.y) {
+						continue;
+					}
+
+					if (narrowphase && !obj.area->collides(*other.area)) {
+						continue;
+					}
+
+					if (num_pairs >= max_pairs) {
+						return num_pairs;
+					}
+					pairs_out[num_pairs].a = handle;
+					pairs_out[num_pairs].b = entry->handle;
+					num_pairs++;
+				}
+			}
+		}
+	}
+
+	return num_pairs;
+}
+
+// Get every pair of areas whose bounds overlap.  Each pair is reported once.
+//
+// returns: number of pairs written to pairs_out.
+//
+int broadphase_grid::get_candidate_pairs(collision_pair *pairs_out, int max_pairs) const
+{
+	return gather_pairs(pairs_out, max_pairs, false);
+}
+
+// Get every pair of areas that actually collide, running the candidate pairs
+// through bounding_area::collides.
+//
+// returns: number of pairs written to pairs_out.
+//
+int broadphase_grid::get_colliding_pairs(collision_pair *pairs_out, int max_pairs) const
+{
+	return gather_pairs(pairs_out, max_pairs, true);
+}
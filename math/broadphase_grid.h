@@ -0,0 +1,85 @@
+#ifndef __BROADPHASE_GRID_H
+#define __BROADPHASE_GRID_H
+
+#pragma once
+
+#include "bbox.h"
+#include "../structures/static_pool.h"
+
+// A uniform-grid broadphase.  The world is split into square cells, and every
+// registered bounding_area is recorded in each cell its bounds touch.  Cells are
+// hashed into a fixed number of buckets, so the grid is unbounded and its memory
+// footprint is fixed at creation.
+//
+// Candidate pairs are only generated between objects that share a cell, so pair
+// generation scales with object count rather than its square, as long as the
+// cell size is on the order of the typical object size.
+//
+
+// Records that an object touches one cell.  Entries live in the used list for
+// the hash bucket of their cell.
+struct broadphase_grid_entry {
+	broadphase_grid_entry() : handle(-1), cell_x(0), cell_y(0), prev(NULL), next(NULL) {}
+
+	int handle;
+	int cell_x;
+	int cell_y;
+	broadphase_grid_entry *prev, *next;
+};
+
+struct broadphase_grid_object {
+	broadphase_grid_object() : area(NULL), cell_min_x(0), cell_min_y(0), cell_max_x(-1), cell_max_y(-1), next_free(-1) {}
+
+	bounding_area *area;
+	collision_filter filter;
+	vector2 bbmin;
+	vector2 bbmax;
+
+	// Inclusive range of cells the bounds touch.
+	int cell_min_x;
+	int cell_min_y;
+	int cell_max_x;
+	int cell_max_y;
+
+	int next_free;
+};
+
+class broadphase_grid {
+	private:
+		float m_cell_size;
+		float m_inv_cell_size;
+
+		broadphase_grid_object *m_objects;
+		int m_max_objects;
+		int m_first_free;
+		int m_num_objects;
+
+		static_pool<broadphase_grid_entry> *m_entries;
+
+		int get_bucket(int cell_x, int cell_y) const;
+		void add_entry(int handle, int cell_x, int cell_y);
+		void remove_entry(int handle, int cell_x, int cell_y);
+		void update_bounds(broadphase_grid_object &obj);
+		int gather_pairs(collision_pair *pairs_out, int max_pairs, bool narrowphase) const;
+
+	public:
+		broadphase_grid(float cell_size, int max_objects, int max_entries, int num_buckets);
+		~broadphase_grid();
+
+		int add(bounding_area *area, const collision_filter &filter = collision_filter());
+		void remove(int handle);
+		void move(int handle, const vector2 &delta);
+		void update(int handle);
+
+		bounding_area *get_area(int handle) const;
+		void set_filter(int handle, const collision_filter &filter);
+		collision_filter get_filter(int handle) const;
+		int get_num_objects() const {return m_num_objects;}
+		float get_cell_size() const {return m_cell_size;}
+
+		int query(const bbox_aligned &bounds, int *handles_out, int max_handles) const;
+		int get_candidate_pairs(collision_pair *pairs_out, int max_pairs) const;
+		int get_colliding_pairs(collision_pair *pairs_out, int max_pairs) const;
+};
+
+#endif // __BROADPHASE_GRID_H
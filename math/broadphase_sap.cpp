@@ -0,0 +1,348 @@
+#include "broadphase_sap.h"
+
+#define SAP_HASH_PRIME_A		(73856093u)
+#define SAP_HASH_PRIME_B		(19349663u)
+
+inline void sap_report_pair(collision_pair *list, int max_pairs, int &num_pairs, int a, int b)
+{
+	// the caller's buffer is too small, and will miss pair changes.
+	Assert_return(list && num_pairs < max_pairs);
+
+	list[num_pairs].a = a;
+	list[num_pairs].b = b;
+	num_pairs++;
+}
+
+// max_objects: maximum number of areas tracked at once.
+// max_pairs: maximum number of pairs overlapping on the x axis at once.
+// num_buckets: number of hash buckets for looking up pairs.
+//
+broadphase_sap::broadphase_sap(int max_objects, int max_pairs, int num_buckets)
+{
+	Assert(max_objects > 0);
+
+	m_max_objects = MAX(max_objects, 1);
+	m_objects = new sap_object[m_max_objects];
+	for (int i = 0; i < m_max_objects - 1; i++) {
+		m_objects[i].next_free = i + 1;
+	}
+	m_objects[m_max_objects - 1].next_free = -1;
+	m_first_free = 0;
+	m_num_objects = 0;
+
+	m_endpoints = new sap_endpoint[m_max_objects * 2];
+	m_num_endpoints = 0;
+
+	m_pairs = new static_pool<sap_pair>(MAX(max_pairs, 1), MAX(num_buckets, 1));
+}
+
+broadphase_sap::~broadphase_sap()
+{
+	if (m_objects) {
+		delete [] m_objects;
+	}
+	if (m_endpoints) {
+		delete [] m_endpoints;
+	}
+	if (m_pairs) {
+		delete m_pairs;
+	}
+}
+
+int broadphase_sap::get_bucket(int a, int b) const
+{
+	uint hash = ((uint)a * SAP_HASH_PRIME_A) ^ ((uint)b * SAP_HASH_PRIME_B);
+	return (int)(hash % (uint)m_pairs->num_used_lists);
+}
+
+sap_pair *broadphase_sap::find_pair(int a, int b) const
+{
+	if (a > b) {
+		SWAP(a, b, int);
+	}
+
+	sap_pair *pair = NULL;
+	DL_FOREACH(m_pairs->used_lists[get_bucket(a, b)], pair) {
+		if (pair->a == a && pair->b == b) {
+			return pair;
+		}
+	}
+	return NULL;
+}
+
+void broadphase_sap::add_pair(int a, int b)
+{
+	if (a > b) {
+		SWAP(a, b, int);
+	}
+
+	if (find_pair(a, b)) {
+		return;
+	}
+
+	sap_pair *pair = m_pairs->alloc(get_bucket(a, b));
+	Assert_return(pair);
+
+	pair->a = a;
+	pair->b = b;
+	pair->overlapping = false;
+}
+
+void broadphase_sap::remove_pair(int a, int b, sap_pair_events &events)
+{
+	sap_pair *pair = find_pair(a, b);
+	if (pair == NULL) {
+		return;
+	}
+
+	if (pair->overlapping) {
+		sap_report_pair(events.removed, events.max_removed, events.num_removed, pair->a, pair->b);
+	}
+
+	m_pairs->free(pair, get_bucket(pair->a, pair->b));
+}
+
+// Start tracking a bounding area.  The broadphase does not take ownership of the
+// area, which must remain valid until it is removed.  Its pairs are reported on
+// the next update.
+//
+// filter: pairs this filter rejects are never reported.
+//
+// returns: handle used to refer to the area, or -1 if the broadphase is full.
+//
+int broadphase_sap::add(bounding_area *area, const collision_filter &filter /*= collision_filter()*/)
+{
+	Assert_return_value(area, -1);
+	Assert_return_value(m_first_free >= 0, -1);
+
+	int handle = m_first_free;
+	sap_object &obj = m_objects[handle];
+	m_first_free = obj.next_free;
+	m_num_objects++;
+
+	obj.area = area;
+	obj.filter = filter;
+	obj.next_free = -1;
+
+	bbox_aligned bounds;
+	bounding_area_get_bounds(*area, bounds);
+	obj.bbmin = bounds.bbmin;
+	obj.bbmax = bounds.bbmax;
+
+	// add the endpoints at the end, and let the next update sort them into place.
+	m_endpoints[m_num_endpoints].value = obj.bbmin.x;
+	m_endpoints[m_num_endpoints].handle = handle;
+	m_endpoints[m_num_endpoints].is_max = false;
+	m_num_endpoints++;
+
+	m_endpoints[m_num_endpoints].value = obj.bbmax.x;
+	m_endpoints[m_num_endpoints].handle = handle;
+	m_endpoints[m_num_endpoints].is_max = true;
+	m_num_endpoints++;
+
+	return handle;
+}
+
+// Stop tracking an area.  Its pairs are dropped without being reported as removed.
+//
+void broadphase_sap::remove(int handle)
+{
+	Assert_return(handle >= 0 && handle < m_max_objects);
+	sap_object &obj = m_objects[handle];
+	Assert_return(obj.area);
+
+	// close the gaps left by its endpoints, keeping the rest in order.
+	int write = 0;
+	for (int read = 0; read < m_num_endpoints; read++) {
+		if (m_endpoints[read].handle != handle) {
+			m_endpoints[write++] = m_endpoints[read];
+		}
+	}
+	m_num_endpoints = write;
+
+	for (int bucket = 0; bucket < m_pairs->num_used_lists; bucket++) {
+		sap_pair *pair = NULL, *next_pair = NULL;
+		DL_FOREACH_DELETE_SAFE(m_pairs->used_lists[bucket], pair, next_pair) {
+			if (pair->a == handle || pair->b == handle) {
+				m_pairs->free(pair, bucket);
+			}
+		}
+	}
+
+	obj.area = NULL;
+	obj.next_free = m_first_free;
+	m_first_free = handle;
+	m_num_objects--;
+}
+
+// Convenience for moving a tracked area.  The change is picked up on the next update.
+//
+void broadphase_sap::move(int handle, const vector2 &delta)
+{
+	Assert_return(handle >= 0 && handle < m_max_objects);
+	Assert_return(m_objects[handle].area);
+
+	m_objects[handle].area->move(delta);
+}
+
+bounding_area *broadphase_sap::get_area(int handle) const
+{
+	Assert_return_value(handle >= 0 && handle < m_max_objects, NULL);
+	return m_objects[handle].area;
+}
+
+// Change which pairs are reported for an area.  Pairs the old filter rejected
+// are found now, and pairs the new one rejects are dropped, so the next update
+// reports the difference.
+//
+void broadphase_sap::set_filter(int handle, const collision_filter &filter)
+{
+	Assert_return(handle >= 0 && handle < m_max_objects);
+	sap_object &obj = m_objects[handle];
+	Assert_return(obj.area);
+
+	obj.filter = filter;
+
+	for (int other_handle = 0; other_handle < m_max_objects; other_handle++) {
+		const sap_object &other = m_objects[other_handle];
+		if (other_handle == handle || other.area == NULL) {
+			continue;
+		}
+		if (!collision_filter_passes(obj.filter, other.filter)) {
+			continue;
+		}
+		if (obj.bbmin.x < other.bbmax.x && other.bbmin.x < obj.bbmax.x) {
+			add_pair(handle, other_handle);
+		}
+	}
+}
+
+collision_filter broadphase_sap::get_filter(int handle) const
+{
+	Assert_return_value(handle >= 0 && handle < m_max_objects, collision_filter());
+	return m_objects[handle].filter;
+}
+
+// Insertion sort the endpoints.  An endpoint moving left past another object's
+// endpoint of the opposite kind either starts or ends an overlap on x.
+//
+void broadphase_sap::sort_endpoints(sap_pair_events &events)
+{
+	for (int i = 1; i < m_num_endpoints; i++) {
+		sap_endpoint moving = m_endpoints[i];
+		int j = i;
+
+		while (j > 0 && m_endpoints[j - 1].value > moving.value) {
+			const sap_endpoint &passed = m_endpoints[j - 1];
+
+			if (passed.is_max != moving.is_max && passed.handle != moving.handle) {
+				if (moving.is_max) {
+					// our max is now left of their min.
+					remove_pair(moving.handle, passed.handle, events);
+				} else {
+					// our min is now left of their max, so we may have started overlapping.
+					const sap_object &obj = m_objects[moving.handle];
+					const sap_object &other = m_objects[passed.handle];
+					if (collision_filter_passes(obj.filter, other.filter) &&
+						obj.bbmin.x < other.bbmax.x && other.bbmin.x < obj.bbmax.x) {
+						add_pair(moving.handle, passed.handle);
+					}
+				}
+			}
+
+			m_endpoints[j] = passed;
+			j--;
+		}
+
+		m_endpoints[j] = moving;
+	}
+}
+
+// Refresh every tracked area and report the pairs whose bounds started or stopped
+// overlapping since the last update.
+//
+// events: buffers to receive the added and removed pairs.  The counts are reset.
+//
+void broadphase_sap::update(sap_pair_events &events)
+{
+	events.num_added = 0;
+	events.num_removed = 0;
+
+	for (int handle = 0; handle < m_max_objects; handle++) {
+		sap_object &obj = m_objects[handle];
+		if (obj.area == NULL) {
+			continue;
+		}
+
+		bbox_aligned bounds;
+		bounding_area_get_bounds(*obj.area, bounds);
+		obj.bbmin = bounds.bbmin;
+		obj.bbmax = bounds.bbmax;
+	}
+
+	for (int i = 0; i < m_num_endpoints; i++) {
+		const sap_object &obj = m_objects[m_endpoints[i].handle];
+		m_endpoints[i].value = m_endpoints[i].is_max ? obj.bbmax.x : obj.bbmin.x;
+	}
+
+	sort_endpoints(events);
+
+	// the surviving pairs overlap on x; check whether their bounds overlap outright.
+	for (int bucket = 0; bucket < m_pairs->num_used_lists; bucket++) {
+		sap_pair *pair = NULL, *next_pair = NULL;
+		DL_FOREACH_DELETE_SAFE(m_pairs->used_lists[bucket], pair, next_pair) {
+			const sap_object &obj_a = m_objects[pair->a];
+			const sap_object &obj_b = m_objects[pair->b];
+
+			// a filter changed since the pair was found.
+			if (!collision_filter_passes(obj_a.filter, obj_b.filter)) {
+				if (pair->overlapping) {
+					sap_report_pair(events.removed, events.max_removed, events.num_removed, pair->a, pair->b);
+				}
+				m_pairs->free(pair, bucket);
+				continue;
+			}
+
+			bool overlapping = obj_a.bbmin.y < obj_b.bbmax.y && obj_b.bbmin.y < obj_a.bbmax.y &&
+				obj_a.bbmin.x < obj_b.bbmax.x && obj_b.bbmin.x < obj_a.bbmax.x;
+
+			if (overlapping == pair->overlapping) {
+				continue;
+			}
+
+			pair->overlapping = overlapping;
+			if (overlapping) {
+				sap_report_pair(events.added, events.max_added, events.num_added, pair->a, pair->b);
+			} else {
+				sap_report_pair(events.removed, events.max_removed, events.num_removed, pair->a, pair->b);
+			}
+		}
+	}
+}
+
+// Get the full list of pairs whose bounds overlapped as of the last update.
+//
+// returns: number of pairs written to pairs_out.
+//
+int broadphase_sap::get_overlapping_pairs(collision_pair *pairs_out, int max_pairs) const
+{
+	Assert_return_value(pairs_out, 0);
+
+	int num_pairs = 0;
+	for (int bucket = 0; bucket < m_pairs->num_used_lists; bucket++) {
+		sap_pair *pair = NULL;
+		DL_FOREACH(m_pairs->used_lists[bucket], pair) {
+			if (!pair->overlapping) {
+				continue;
+			}
+			if (num_pairs >= max_pairs) {
+				return num_pairs;
+			}
+			pairs_out[num_pairs].a = pair->a;
+			pairs_out[num_pairs].b = pair->b;
+			num_pairs++;
+		}
+	}
+
+	return num_pairs;
+}
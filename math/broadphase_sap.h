@@ -0,0 +1,95 @@
+#ifndef __BROADPHASE_SAP_H
+#define __BROADPHASE_SAP_H
+
+#pragma once
+
+#include "bbox.h"
+#include "../structures/static_pool.h"
+
+// Sweep-and-prune broadphase.  Each tracked area is projected onto the x axis, and
+// the interval endpoints are kept in a single sorted array between updates.
+//
+// Since most areas barely move from one frame to the next, the array is nearly
+// sorted every update, and an insertion sort restores it in close to linear time.
+// Every swap during the sort is a change in which intervals overlap, so the set of
+// x-overlapping pairs is maintained incrementally rather than rebuilt.  Of those,
+// pairs whose bounds also overlap on y are reported as added or removed as their
+// state changes.
+//
+// Pairs rejected by their collision filters are never tracked at all.
+//
+
+struct sap_endpoint {
+	float value;
+	int handle;
+	bool is_max;
+};
+
+struct sap_object {
+	sap_object() : area(NULL), next_free(-1) {}
+
+	bounding_area *area;
+	collision_filter filter;
+	vector2 bbmin;
+	vector2 bbmax;
+	int next_free;
+};
+
+// A pair of areas whose x intervals overlap.  Pairs live in the used list for
+// the hash bucket of their handles.
+struct sap_pair {
+	sap_pair() : a(-1), b(-1), overlapping(false), prev(NULL), next(NULL) {}
+
+	int a;
+	int b;
+	bool overlapping;		// bounds overlap on both axes.
+	sap_pair *prev, *next;
+};
+
+// Output buffers for the pairs that changed state during an update.
+struct sap_pair_events {
+	collision_pair *added;
+	int max_added;
+	int num_added;
+
+	collision_pair *removed;
+	int max_removed;
+	int num_removed;
+};
+
+class broadphase_sap {
+	private:
+		sap_object *m_objects;
+		int m_max_objects;
+		int m_first_free;
+		int m_num_objects;
+
+		sap_endpoint *m_endpoints;
+		int m_num_endpoints;
+
+		static_pool<sap_pair> *m_pairs;
+
+		int get_bucket(int a, int b) const;
+		sap_pair *find_pair(int a, int b) const;
+		void add_pair(int a, int b);
+		void remove_pair(int a, int b, sap_pair_events &events);
+		void sort_endpoints(sap_pair_events &events);
+
+	public:
+		broadphase_sap(int max_objects, int max_pairs, int num_buckets);
+		~broadphase_sap();
+
+		int add(bounding_area *area, const collision_filter &filter = collision_filter());
+		void remove(int handle);
+		void move(int handle, const vector2 &delta);
+
+		bounding_area *get_area(int handle) const;
+		void set_filter(int handle, const collision_filter &filter);
+		collision_filter get_filter(int handle) const;
+		int get_num_objects() const {return m_num_objects;}
+
+		void update(sap_pair_events &events);
+		int get_overlapping_pairs(collision_pair *pairs_out, int max_pairs) const;
+};
+
+#endif // __BROADPHASE_SAP_H
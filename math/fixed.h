@@ -0,0 +1,132 @@
+#ifndef __FIXED_H
+#define __FIXED_H
+
+#pragma once
+
+#include <stdint.h>
+
+#include "ss_math.h"
+#include "../util.h"
+
+// Fixed-point scalar for deterministic simulation, ie. lockstep multiplayer, where
+// every machine has to come up with bit-identical results.
+//
+// Values are 64-bit integers with 16 fractional bits, so the resolution is about
+// 0.000015.  Sums are good to about +/-140 trillion, and products are taken in 64
+// bits before shifting back down, which holds as long as the result is under
+// about 2 billion.  That covers squared distances out to about 46000 units, which
+// a 16.16 type would overflow almost immediately.
+//
+// Everything is integer math, including sin, cos, atan2 and sqrt, which use
+// baked tables rather than the C library and are good to about 0.00005.
+// Converting from float rounds the same way on every machine, so fixed-point
+// state can be seeded from data files safely.  Converting back to float is only
+// for display.
+//
+
+#define FIXED_FRAC_BITS			(16)
+#define FIXED_ONE_RAW			((int64_t)1 << FIXED_FRAC_BITS)
+
+struct fixed {
+	int64_t raw;
+
+	fixed() : raw(0) {}
+	explicit fixed(int n) : raw((int64_t)n * FIXED_ONE_RAW) {}
+
+	static inline fixed from_raw(int64_t raw) {
+		fixed f;
+		f.raw = raw;
+		return f;
+	}
+	static inline fixed from_float(float n) {
+		return from_raw((int64_t)floor(((double)n * (double)FIXED_ONE_RAW) + 0.5));
+	}
+	inline float to_float() const {
+		return (float)((double)raw / (double)FIXED_ONE_RAW);
+	}
+
+	// Rounds toward negative infinity.
+	inline int to_int() const {
+		return (int)(raw >> FIXED_FRAC_BITS);
+	}
+
+	const bool operator == (const fixed &f) const {return raw == f.raw;}
+	const bool operator != (const fixed &f) const {return raw != f.raw;}
+	const bool operator < (const fixed &f) const {return raw < f.raw;}
+	const bool operator > (const fixed &f) const {return raw > f.raw;}
+	const bool operator <= (const fixed &f) const {return raw <= f.raw;}
+	const bool operator >= (const fixed &f) const {return raw >= f.raw;}
+
+	const fixed operator - () const {
+		return from_raw(-raw);
+	}
+	const fixed operator + (const fixed &f) const {
+		return from_raw(raw + f.raw);
+	}
+	const fixed operator - (const fixed &f) const {
+		return from_raw(raw - f.raw);
+	}
+	const fixed operator * (const fixed &f) const {
+		return from_raw((raw * f.raw) >> FIXED_FRAC_BITS);
+	}
+	const fixed operator / (const fixed &f) const {
+		Assert_return_value(f.raw != 0, fixed());
+		return from_raw((raw * FIXED_ONE_RAW) / f.raw);
+	}
+
+	// scaling by an integer is exact.
+	const fixed operator * (int n) const {
+		return from_raw(raw * n);
+	}
+	const fixed operator / (int n) const {
+		Assert_return_value(n != 0, fixed());
+		return from_raw(raw / n);
+	}
+
+	const fixed& operator += (const fixed &f) {
+		raw += f.raw;
+		return *this;
+	}
+	const fixed& operator -= (const fixed &f) {
+		raw -= f.raw;
+		return *this;
+	}
+	const fixed& operator *= (const fixed &f) {
+		*this = *this * f;
+		return *this;
+	}
+	const fixed& operator /= (const fixed &f) {
+		*this = *this / f;
+		return *this;
+	}
+};
+
+const fixed FIXED_ZERO = fixed::from_raw(0);
+const fixed FIXED_ONE = fixed::from_raw(FIXED_ONE_RAW);
+const fixed FIXED_HALF = fixed::from_raw(FIXED_ONE_RAW / 2);
+const fixed FIXED_PI = fixed::from_raw(205887);
+const fixed FIXED_PI_OVER_2 = fixed::from_raw(102944);
+const fixed FIXED_TWO_PI = fixed::from_raw(411775);
+
+inline fixed fx_abs(const fixed &f)
+{
+	return (f.raw < 0) ? -f : f;
+}
+
+inline fixed fx_min(const fixed &a, const fixed &b)
+{
+	return (a < b) ? a : b;
+}
+
+inline fixed fx_max(const fixed &a, const fixed &b)
+{
+	return (a > b) ? a : b;
+}
+
+fixed fx_sqrt(const fixed &f);
+fixed fx_sin(const fixed &radians);
+fixed fx_cos(const fixed &radians);
+void fx_sincos(const fixed &radians, fixed &sin_out, fixed &cos_out);
+fixed fx_atan2(const fixed &y, const fixed &x);
+
+#endif // __FIXED_H
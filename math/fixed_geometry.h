@@ -0,0 +1,344 @@
+#ifndef __FIXED_GEOMETRY_H
+#define __FIXED_GEOMETRY_H
+
+#pragma once
+
+#include "fixed.h"
+#include "bbox.h"
+
+// Vector, matrix and bounding area types templated on their scalar, with the
+// collision and transform functions the float versions have.  Instantiated with
+// fixed, they give bit-identical results everywhere, for lockstep simulation.
+// The float instantiation is there so the same gameplay code can be built either
+// way.
+//
+// The math is kept to adds, multiplies and comparisons wherever the float
+// versions allow it, so there's no trig outside of make_heading, rotate and
+// extract_heading.  Unlike matrix, products of matrices aren't renormalized, since
+// there's no drift to correct in fixed point.
+//
+
+// Scalar functions the templates are written against.
+inline float scalar_abs(float n) {return fabsf(n);}
+inline float scalar_sqrt(float n) {return sqrtf(n);}
+inline float scalar_sin(float n) {return sinf(n);}
+inline float scalar_cos(float n) {return cosf(n);}
+inline float scalar_atan2(float y, float x) {return atan2f(y, x);}
+
+inline fixed scalar_abs(const fixed &n) {return fx_abs(n);}
+inline fixed scalar_sqrt(const fixed &n) {return fx_sqrt(n);}
+inline fixed scalar_sin(const fixed &n) {return fx_sin(n);}
+inline fixed scalar_cos(const fixed &n) {return fx_cos(n);}
+inline fixed scalar_atan2(const fixed &y, const fixed &x) {return fx_atan2(y, x);}
+
+template <class T>
+struct vector2_t {
+	T x;
+	T y;
+
+	vector2_t() : x(0), y(0) {}
+	vector2_t(const T &_x, const T &_y) : x(_x), y(_y) {}
+
+	const bool operator == (const vector2_t &v) const {
+		return (v.x == x) && (v.y == y);
+	}
+	const bool operator != (const vector2_t &v) const {
+		return (v.x != x) || (v.y != y);
+	}
+	const vector2_t operator - () const {
+		return vector2_t(-x, -y);
+	}
+	const vector2_t& operator += (const vector2_t &v) {
+		x += v.x;
+		y += v.y;
+		return *this;
+	}
+	const vector2_t& operator -= (const vector2_t &v) {
+		x -= v.x;
+		y -= v.y;
+		return *this;
+	}
+	const vector2_t operator + (const vector2_t &v) const {
+		return vector2_t(x + v.x, y + v.y);
+	}
+	const vector2_t operator - (const vector2_t &v) const {
+		return vector2_t(x - v.x, y - v.y);
+	}
+	const vector2_t operator * (const T &c) const {
+		return vector2_t(x * c, y * c);
+	}
+	const vector2_t operator / (const T &c) const {
+		return vector2_t(x / c, y / c);
+	}
+
+	// Returns perpendicular vector to the right (assuming this is a uvec).
+	const vector2_t rvec() const {
+		return vector2_t(y, -x);
+	}
+
+	// Returns the perpendicular vector to the left
+	const vector2_t lvec() const {
+		return vector2_t(-y, x);
+	}
+
+	const T dot(const vector2_t &v) const {
+		return (x * v.x) + (y * v.y);
+	}
+	const T cross(const vector2_t &v) const {
+		return (x * v.y) - (y * v.x);
+	}
+	const T mag_squared() const {
+		return dot(*this);
+	}
+	const T mag() const {
+		return scalar_sqrt(mag_squared());
+	}
+	const T dist_squared(const vector2_t &v) const {
+		return (*this - v).mag_squared();
+	}
+	const T extract_heading() const {
+		return scalar_atan2(y, x);
+	}
+};
+
+template <class T>
+struct matrix_t {
+	vector2_t<T> rvec;
+	vector2_t<T> uvec;
+
+	matrix_t() {
+		set_identity();
+	}
+	matrix_t(const vector2_t<T> &_rvec, const vector2_t<T> &_uvec) : rvec(_rvec), uvec(_uvec) {}
+
+	const bool operator == (const matrix_t &m) const {
+		return (rvec == m.rvec) && (uvec == m.uvec);
+	}
+	const bool operator != (const matrix_t &m) const {
+		return !(m == *this);
+	}
+
+	inline void set_identity() {
+		rvec = vector2_t<T>(T(1), T(0));
+		uvec = vector2_t<T>(T(0), T(1));
+	}
+
+	inline void make_heading(const T &heading) {
+		T sin = scalar_sin(heading);
+		T cos = scalar_cos(heading);
+		rvec = vector2_t<T>(cos, sin);
+		uvec = vector2_t<T>(-sin, cos);
+	}
+
+	void rotate(const T &theta) {
+		matrix_t rotation;
+		rotation.make_heading(theta);
+		*this = rotation * (*this);
+	}
+
+	inline T extract_heading() const {
+		return scalar_atan2(rvec.y, rvec.x);
+	}
+
+	// For a rotation, the inverse, without any trig.
+	inline matrix_t transpose_copy() const {
+		return matrix_t(vector2_t<T>(rvec.x, uvec.x), vector2_t<T>(rvec.y, uvec.y));
+	}
+
+	// post-multiply by a vector
+	const vector2_t<T> operator * (const vector2_t<T> &v) const {
+		return (rvec * v.x) + (uvec * v.y);
+	}
+
+	// pre-multiply by a vector
+	inline friend const vector2_t<T> operator * (const vector2_t<T> &v, const matrix_t &m) {
+		return vector2_t<T>(m.rvec.dot(v), m.uvec.dot(v));
+	}
+
+	// post-multiply by a matrix
+	const matrix_t operator * (const matrix_t &m) const {
+		return matrix_t(*this * m.rvec, *this * m.uvec);
+	}
+};
+
+template <class T>
+struct bbox_aligned_t {
+	bbox_aligned_t() {}
+	bbox_aligned_t(const vector2_t<T> &min, const vector2_t<T> &max) : bbmin(min), bbmax(max) {}
+
+	vector2_t<T> bbmin;
+	vector2_t<T> bbmax;
+};
+
+template <class T>
+struct bbox_oriented_t {
+	bbox_oriented_t() {}
+	bbox_oriented_t(const vector2_t<T> &_center, const vector2_t<T> &_size, const matrix_t<T> &_orient)
+		: center(_center), size(_size), orient(_orient) {}
+
+	vector2_t<T> center;
+	vector2_t<T> size;
+	matrix_t<T> orient;
+
+	void get_extents(vector2_t<T> &half_rvec_out, vector2_t<T> &half_uvec_out) const {
+		half_rvec_out = orient.rvec * (size.x / 2);
+		half_uvec_out = orient.uvec * (size.y / 2);
+	}
+};
+
+template <class T>
+struct bcircle_t {
+	bcircle_t() : radius(0) {}
+	bcircle_t(const vector2_t<T> &_center, const T &_radius) : center(_center), radius(_radius) {}
+
+	vector2_t<T> center;
+	T radius;
+};
+
+typedef vector2_t<fixed> fixed_vector2;
+typedef matrix_t<fixed> fixed_matrix;
+typedef bbox_aligned_t<fixed> fixed_bbox_aligned;
+typedef bbox_oriented_t<fixed> fixed_bbox_oriented;
+typedef bcircle_t<fixed> fixed_bcircle;
+
+template <class T>
+void world_to_local(const vector2_t<T> &pos_in, const vector2_t<T> &local_origin, const matrix_t<T> &local_origin_orient, vector2_t<T> &pos_out)
+{
+	pos_out = (pos_in - local_origin) * local_origin_orient;
+}
+
+template <class T>
+void local_to_world(const vector2_t<T> &pos_in, const vector2_t<T> &local_origin, const matrix_t<T> &local_origin_orient, vector2_t<T> &pos_out)
+{
+	pos_out = (local_origin_orient * pos_in) + local_origin;
+}
+
+template <class T>
+bool bbox_intersects_point(const bbox_aligned_t<T> &bbox, const vector2_t<T> &pt)
+{
+	return !(pt.x > bbox.bbmax.x || pt.x < bbox.bbmin.x || pt.y > bbox.bbmax.y || pt.y < bbox.bbmin.y);
+}
+
+// Boxes that merely touch are overlapping, the same as the float version.
+//
+template <class T>
+bool bbox_overlap(const bbox_aligned_t<T> &bbox1, const bbox_aligned_t<T> &bbox2)
+{
+	return !(bbox1.bbmax.x < bbox2.bbmin.x || bbox2.bbmax.x < bbox1.bbmin.x ||
+		bbox1.bbmax.y < bbox2.bbmin.y || bbox2.bbmax.y < bbox1.bbmin.y);
+}
+
+// Boxes that merely touch are not considered overlapping.
+//
+template <class T>
+bool bbox_overlap(const bbox_oriented_t<T> &bbox1, const bbox_oriented_t<T> &bbox2)
+{
+	vector2_t<T> offset = bbox2.center - bbox1.center;
+	vector2_t<T> half_r1, half_u1, half_r2, half_u2;
+	bbox1.get_extents(half_r1, half_u1);
+	bbox2.get_extents(half_r2, half_u2);
+
+	const vector2_t<T> *axes[4] = {&bbox1.orient.rvec, &bbox1.orient.uvec, &bbox2.orient.rvec, &bbox2.orient.uvec};
+	for (int i = 0; i < 4; i++) {
+		const vector2_t<T> &axis = *axes[i];
+
+		T dist = scalar_abs(offset.dot(axis));
+		T radius = scalar_abs(half_r1.dot(axis)) + scalar_abs(half_u1.dot(axis)) +
+			scalar_abs(half_r2.dot(axis)) + scalar_abs(half_u2.dot(axis));
+		if (dist >= radius) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+template <class T>
+bool circle_overlap(const bcircle_t<T> &circle1, const bcircle_t<T> &circle2)
+{
+	if (circle1.radius == T(0) || circle2.radius == T(0)) {
+		return false;
+	}
+
+	T radius = circle1.radius + circle2.radius;
+	return circle1.center.dist_squared(circle2.center) < radius * radius;
+}
+
+// Edges count as touching, corners have to be strictly inside the circle, the
+// same as the float version.
+//
+template <class T>
+bool bbox_intersects_circle(const bbox_aligned_t<T> &bbox, const bcircle_t<T> &circle)
+{
+	const vector2_t<T> &bbmin = bbox.bbmin;
+	const vector2_t<T> &bbmax = bbox.bbmax;
+	const vector2_t<T> &center = circle.center;
+
+	if (center.x <= bbmax.x && center.x >= bbmin.x && center.y <= bbmax.y && center.y >= bbmin.y) {
+		return true;
+	}
+
+	// beyond a corner, only the corner matters.
+	bool left = center.x < bbmin.x;
+	bool right = center.x > bbmax.x;
+	bool below = center.y < bbmin.y;
+	bool above = center.y > bbmax.y;
+	if ((left || right) && (below || above)) {
+		vector2_t<T> corner(left ? bbmin.x : bbmax.x, below ? bbmin.y : bbmax.y);
+		return center.dist_squared(corner) < circle.radius * circle.radius;
+	}
+
+	T radius = scalar_abs(circle.radius);
+	return !(center.x + radius < bbmin.x || bbmax.x < center.x - radius ||
+		center.y + radius < bbmin.y || bbmax.y < center.y - radius);
+}
+
+template <class T>
+bool bbox_intersects_circle(const bbox_oriented_t<T> &bbox, const bcircle_t<T> &circle)
+{
+	vector2_t<T> local_center;
+	world_to_local(circle.center, bbox.center, bbox.orient, local_center);
+
+	vector2_t<T> half_size = bbox.size / T(2);
+	return bbox_intersects_circle(bbox_aligned_t<T>(-half_size, half_size), bcircle_t<T>(local_center, circle.radius));
+}
+
+// Conversions to and from the float types, ie. for loading data and drawing.
+// Going to fixed point rounds to the nearest representable value.
+
+inline fixed_vector2 to_fixed(const vector2 &v)
+{
+	return fixed_vector2(fixed::from_float(v.x), fixed::from_float(v.y));
+}
+
+inline fixed_matrix to_fixed(const matrix &m)
+{
+	return fixed_matrix(to_fixed(m.rvec), to_fixed(m.uvec));
+}
+
+inline fixed_bbox_aligned to_fixed(const bbox_aligned &bbox)
+{
+	return fixed_bbox_aligned(to_fixed(bbox.bbmin), to_fixed(bbox.bbmax));
+}
+
+inline fixed_bbox_oriented to_fixed(const bbox_oriented &bbox)
+{
+	return fixed_bbox_oriented(to_fixed(bbox.center), to_fixed(bbox.size), to_fixed(bbox.orient));
+}
+
+inline fixed_bcircle to_fixed(const bcircle &circle)
+{
+	return fixed_bcircle(to_fixed(circle.center), fixed::from_float(circle.radius));
+}
+
+inline vector2 to_float(const fixed_vector2 &v)
+{
+	return vector2(v.x.to_float(), v.y.to_float());
+}
+
+inline matrix to_float(const fixed_matrix &m)
+{
+	return matrix(to_float(m.rvec), to_float(m.uvec));
+}
+
+#endif // __FIXED_GEOMETRY_H
@@ -0,0 +1,371 @@
+#include "manifold.h"
+
+#include <cfloat>
+
+// How much deeper box b's best face has to be before it's used as the reference
+// instead of box a's, so the reference face doesn't flicker between frames.
+#define MANIFOLD_FACE_TOLERANCE		(0.001f)
+
+// A box as unit axes and half extents along them.
+struct manifold_box {
+	vector2 center;
+	vector2 axis[2];
+	float half[2];
+};
+
+static void manifold_box_from_shape(const bounding_shape &shape, manifold_box &box_out)
+{
+	box_out.center = shape.center;
+	box_out.axis[0] = shape.orient.rvec;
+	box_out.axis[1] = shape.orient.uvec;
+	box_out.half[0] = fl_abs(shape.size.x) * 0.5f;
+	box_out.half[1] = fl_abs(shape.size.y) * 0.5f;
+}
+
+// Find the face of ref that other penetrates least.
+//
+// offset: center of other relative to the center of ref.
+//
+// returns: false if one of ref's axes separates the boxes.
+//
+static bool manifold_box_max_separation(const manifold_box &ref, const manifold_box &other, const vector2 &offset,
+	float &separation_out, int &axis_out)
+{
+	separation_out = -FLT_MAX;
+	axis_out = 0;
+
+	for (int i = 0; i < 2; i++) {
+		const vector2 &axis = ref.axis[i];
+		float radius = ref.half[i] + other.half[0] * fl_abs(other.axis[0].dot(axis)) + other.half[1] * fl_abs(other.axis[1].dot(axis));
+		float separation = fl_abs(offset.dot(axis)) - radius;
+
+		if (separation >= 0) {
+			return false;
+		}
+		if (separation > separation_out) {
+			separation_out = separation;
+			axis_out = i;
+		}
+	}
+
+	return true;
+}
+
+// Clip a segment to the inside of a plane, keeping points where dot(p, normal) <= offset.
+//
+// returns: number of points left, out of two.
+//
+static int manifold_clip_segment(const vector2 in[2], vector2 out[2], const vector2 &normal, float offset)
+{
+	int num_out = 0;
+	float dist0 = in[0].dot(normal) - offset;
+	float dist1 = in[1].dot(normal) - offset;
+
+	if (dist0 <= 0) {
+		out[num_out++] = in[0];
+	}
+	if (dist1 <= 0) {
+		out[num_out++] = in[1];
+	}
+
+	// the points straddle the plane, so add where the segment crosses it.
+	if (dist0 * dist1 < 0) {
+		out[num_out++] = in[0] + (in[1] - in[0]) * (dist0 / (dist0 - dist1));
+	}
+
+	return num_out;
+}
+
+// Separating axis test that keeps the face of least penetration, then clips the
+// opposing box's face against it for the contact points.
+//
+static bool manifold_box_box(const manifold_box &a, const manifold_box &b, contact_manifold &manifold_out)
+{
+	vector2 offset = b.center - a.center;
+
+	float separation_a, separation_b;
+	int axis_a, axis_b;
+	if (!manifold_box_max_separation(a, b, offset, separation_a, axis_a)) {
+		return false;
+	}
+	if (!manifold_box_max_separation(b, a, -offset, separation_b, axis_b)) {
+		return false;
+	}
+
+	const manifold_box *ref = &a;
+	const manifold_box *inc = &b;
+	int ref_axis = axis_a;
+	float separation = separation_a;
+	bool flip = false;
+	if (separation_b > separation_a + MANIFOLD_FACE_TOLERANCE) {
+		ref = &b;
+		inc = &a;
+		ref_axis = axis_b;
+		separation = separation_b;
+		flip = true;
+		offset = -offset;
+	}
+
+	// reference face normal, pointing toward the incident box.
+	vector2 normal = ref->axis[ref_axis];
+	if (offset.dot(normal) < 0) {
+		normal = -normal;
+	}
+	vector2 tangent = ref->axis[1 - ref_axis];
+	float ref_half_tangent = ref->half[1 - ref_axis];
+
+	// the incident face is the one most opposed to the reference face.
+	float dot0 = inc->axis[0].dot(normal);
+	float dot1 = inc->axis[1].dot(normal);
+	int inc_axis = (fl_abs(dot0) > fl_abs(dot1)) ? 0 : 1;
+	float inc_dot = (inc_axis == 0) ? dot0 : dot1;
+	vector2 inc_face_normal = (inc_dot > 0) ? -inc->axis[inc_axis] : inc->axis[inc_axis];
+
+	vector2 inc_face_center = inc->center + inc_face_normal * inc->half[inc_axis];
+	vector2 inc_edge = inc->axis[1 - inc_axis] * inc->half[1 - inc_axis];
+	vector2 inc_face[2] = {inc_face_center + inc_edge, inc_face_center - inc_edge};
+
+	// clip it to the sides of the reference face.
+	float ref_tangent = ref->center.dot(tangent);
+	vector2 clipped1[2], clipped2[2];
+	int num_clipped = manifold_clip_segment(inc_face, clipped1, tangent, ref_tangent + ref_half_tangent);
+	if (num_clipped >= 2) {
+		num_clipped = manifold_clip_segment(clipped1, clipped2, -tangent, -ref_tangent + ref_half_tangent);
+	}
+
+	// keep the points below the reference face, moved halfway up to it.
+	float ref_front = ref->center.dot(normal) + ref->half[ref_axis];
+	manifold_out.num_points = 0;
+	if (num_clipped >= 2) {
+		for (int i = 0; i < 2; i++) {
+			float point_separation = clipped2[i].dot(normal) - ref_front;
+			if (point_separation <= 0) {
+				manifold_out.points[manifold_out.num_points++] = clipped2[i] - normal * (point_separation * 0.5f);
+			}
+		}
+	}
+
+	// precision trouble with nearly degenerate boxes.  Fall back on the incident
+	// box's deepest corner.
+	if (manifold_out.num_points == 0) {
+		vector2 corner = inc->center;
+		for (int i = 0; i < 2; i++) {
+			float dot = inc->axis[i].dot(normal);
+			corner += inc->axis[i] * ((dot > 0) ? -inc->half[i] : inc->half[i]);
+		}
+		float point_separation = corner.dot(normal) - ref_front;
+		manifold_out.points[manifold_out.num_points++] = corner - normal * (point_separation * 0.5f);
+	}
+
+	manifold_out.normal = flip ? -normal : normal;
+	manifold_out.depth = -separation;
+	return true;
+}
+
+// Box a against circle b, with the box given by its shape.
+//
+static bool manifold_box_circle(const bounding_shape &box, const vector2 &circle_center, float radius, contact_manifold &manifold_out)
+{
+	vector2 half_size(fl_abs(box.size.x) * 0.5f, fl_abs(box.size.y) * 0.5f);
+
+	vector2 local_center;
+	world_to_local(circle_center, box.center, box.orient, local_center);
+
+	vector2 local_normal;
+	vector2 surface_point;
+	float depth;
+
+	float inside_x = half_size.x - fl_abs(local_center.x);
+	float inside_y = half_size.y - fl_abs(local_center.y);
+	if (inside_x >= 0 && inside_y >= 0) {
+		// the center is inside the box, so push out through the nearest face.
+		surface_point = local_center;
+		if (inside_x < inside_y) {
+			local_normal = vector2(fl_sign(local_center.x), 0.0f);
+			surface_point.x = local_normal.x * half_size.x;
+			depth = radius + inside_x;
+		} else {
+			local_normal = vector2(0.0f, fl_sign(local_center.y));
+			surface_point.y = local_normal.y * half_size.y;
+			depth = radius + inside_y;
+		}
+	} else {
+		surface_point = vector2(fl_cap(local_center.x, -half_size.x, half_size.x), fl_cap(local_center.y, -half_size.y, half_size.y));
+		// like bounding_shape_collides, a circle touching a side counts (with
+		// no depth), but one touching a corner doesn't.
+		vector2 offset = local_center - surface_point;
+		float dist_sq = offset.mag_squared();
+		bool at_corner = inside_x < 0 && inside_y < 0;
+		if (dist_sq > SQUARED(radius) || (at_corner && dist_sq == SQUARED(radius))) {
+			return false;
+		}
+
+		float dist = sqrt(dist_sq);
+		local_normal = offset / dist;
+		depth = radius - dist;
+	}
+
+	manifold_out.normal = box.orient * local_normal;
+	manifold_out.depth = depth;
+	local_to_world(surface_point, box.center, box.orient, manifold_out.points[0]);
+	manifold_out.points[0] -= manifold_out.normal * (depth * 0.5f);
+	manifold_out.num_points = 1;
+	return true;
+}
+
+// Zero radius circles never collide with each other, as in circle_overlap.
+//
+static bool manifold_circle_circle(const vector2 &center_a, float radius_a, const vector2 &center_b, float radius_b, contact_manifold &manifold_out)
+{
+	if (radius_a == 0 || radius_b == 0) {
+		return false;
+	}
+
+	vector2 offset = center_b - center_a;
+	float dist_sq = offset.mag_squared();
+	float radius = radius_a + radius_b;
+	if (dist_sq >= SQUARED(radius)) {
+		return false;
+	}
+
+	float dist = sqrt(dist_sq);
+	manifold_out.normal = offset.copy_normalize_safe(RIGHT_VECTOR);
+	manifold_out.depth = radius - dist;
+	manifold_out.points[0] = center_a + manifold_out.normal * (radius_a - manifold_out.depth * 0.5f);
+	manifold_out.num_points = 1;
+	return true;
+}
+
+bool collide_manifold(const bbox_oriented &a, const bbox_oriented &b, contact_manifold &manifold_out)
+{
+	bounding_shape shape_a, shape_b;
+	a.get_shape(shape_a);
+	b.get_shape(shape_b);
+
+	manifold_box box_a, box_b;
+	manifold_box_from_shape(shape_a, box_a);
+	manifold_box_from_shape(shape_b, box_b);
+
+	return manifold_box_box(box_a, box_b, manifold_out);
+}
+
+// Aligned boxes overlap in a rectangle.  The normal is along the axis that takes
+// the shortest push to separate them, and the contacts are at either end of the
+// rectangle's centerline across that axis.  Touching boxes count as
+// overlapping, as in bbox_overlap and bounding_shape_collides, and get a contact
+// with no depth.
+//
+bool collide_manifold(const bbox_aligned &a, const bbox_aligned &b, contact_manifold &manifold_out)
+{
+	float a_min_x, a_max_x, a_min_y, a_max_y;
+	float b_min_x, b_max_x, b_min_y, b_max_y;
+	a_min_x = MIN(a.bbmin.x, a.bbmax.x);
+	a_max_x = MAX(a.bbmin.x, a.bbmax.x);
+	a_min_y = MIN(a.bbmin.y, a.bbmax.y);
+	a_max_y = MAX(a.bbmin.y, a.bbmax.y);
+	b_min_x = MIN(b.bbmin.x, b.bbmax.x);
+	b_max_x = MAX(b.bbmin.x, b.bbmax.x);
+	b_min_y = MIN(b.bbmin.y, b.bbmax.y);
+	b_max_y = MAX(b.bbmin.y, b.bbmax.y);
+
+	vector2 overlap_min(MAX(a_min_x, b_min_x), MAX(a_min_y, b_min_y));
+	vector2 overlap_max(MIN(a_max_x, b_max_x), MIN(a_max_y, b_max_y));
+	if (overlap_min.x > overlap_max.x || overlap_min.y > overlap_max.y) {
+		return false;
+	}
+
+	// on each axis, push b out whichever side is shorter.
+	float push_pos_x = a_max_x - b_min_x;
+	float push_neg_x = b_max_x - a_min_x;
+	float push_pos_y = a_max_y - b_min_y;
+	float push_neg_y = b_max_y - a_min_y;
+	float depth_x = MIN(push_pos_x, push_neg_x);
+	float depth_y = MIN(push_pos_y, push_neg_y);
+
+	vector2 overlap_center = (overlap_min + overlap_max) * 0.5f;
+	if (depth_x < depth_y) {
+		manifold_out.normal = vector2((push_pos_x <= push_neg_x) ? 1.0f : -1.0f, 0.0f);
+		manifold_out.depth = depth_x;
+		manifold_out.points[0] = vector2(overlap_center.x, overlap_min.y);
+		manifold_out.points[1] = vector2(overlap_center.x, overlap_max.y);
+	} else {
+		manifold_out.normal = vector2(0.0f, (push_pos_y <= push_neg_y) ? 1.0f : -1.0f);
+		manifold_out.depth = depth_y;
+		manifold_out.points[0] = vector2(overlap_min.x, overlap_center.y);
+		manifold_out.points[1] = vector2(overlap_max.x, overlap_center.y);
+	}
+	manifold_out.num_points = 2;
+	return true;
+}
+
+bool collide_manifold(const bbox_oriented &a, const bcircle &b, contact_manifold &manifold_out)
+{
+	bounding_shape shape_a;
+	a.get_shape(shape_a);
+	return manifold_box_circle(shape_a, b.center, b.radius, manifold_out);
+}
+
+bool collide_manifold(const bcircle &a, const bbox_oriented &b, contact_manifold &manifold_out)
+{
+	bounding_shape shape_b;
+	b.get_shape(shape_b);
+	if (!manifold_box_circle(shape_b, a.center, a.radius, manifold_out)) {
+		return false;
+	}
+
+	manifold_out.normal = -manifold_out.normal;
+	return true;
+}
+
+bool collide_manifold(const bcircle &a, const bcircle &b, contact_manifold &manifold_out)
+{
+	return manifold_circle_circle(a.center, a.radius, b.center, b.radius, manifold_out);
+}
+
+bool collide_manifold(const bounding_shape &a, const bounding_shape &b, contact_manifold &manifold_out)
+{
+	bool a_is_circle = a.type == BAT_CIRCLE;
+	bool b_is_circle = b.type == BAT_CIRCLE;
+	Assert_return_value(a_is_circle || a.type == BAT_BOX_ALIGNED || a.type == BAT_BOX_ORIENTED, false);
+	Assert_return_value(b_is_circle || b.type == BAT_BOX_ALIGNED || b.type == BAT_BOX_ORIENTED, false);
+
+	if (a_is_circle && b_is_circle) {
+		return manifold_circle_circle(a.center, a.size.x, b.center, b.size.x, manifold_out);
+	}
+
+	if (b_is_circle) {
+		return manifold_box_circle(a, b.center, b.size.x, manifold_out);
+	}
+
+	if (a_is_circle) {
+		if (!manifold_box_circle(b, a.center, a.size.x, manifold_out)) {
+			return false;
+		}
+		manifold_out.normal = -manifold_out.normal;
+		return true;
+	}
+
+	if (a.type == BAT_BOX_ALIGNED && b.type == BAT_BOX_ALIGNED) {
+		vector2 half_a = a.size * 0.5f;
+		vector2 half_b = b.size * 0.5f;
+		bbox_aligned box_a(a.center - half_a, a.center + half_a);
+		bbox_aligned box_b(b.center - half_b, b.center + half_b);
+		return collide_manifold(box_a, box_b, manifold_out);
+	}
+
+	manifold_box box_a, box_b;
+	manifold_box_from_shape(a, box_a);
+	manifold_box_from_shape(b, box_b);
+	return manifold_box_box(box_a, box_b, manifold_out);
+}
+
+// Handles every pairing, including unified areas, which stand in for their inner type.
+//
+bool collide_manifold(const bounding_area &a, const bounding_area &b, contact_manifold &manifold_out)
+{
+	bounding_shape shape_a, shape_b;
+	a.get_shape(shape_a);
+	b.get_shape(shape_b);
+
+	return collide_manifold(shape_a, shape_b, manifold_out);
+}
@@ -0,0 +1,40 @@
+#ifndef __MANIFOLD_H
+#define __MANIFOLD_H
+
+#pragma once
+
+#include "bbox.h"
+
+#define MANIFOLD_MAX_POINTS		(2)
+
+// Everything needed to push two overlapping shapes apart, found in the same pass
+// as the overlap test itself.
+//
+// Pushing b along the normal by depth (or a against it) separates the shapes.
+// Contact points sit midway through the overlap.  Box against box makes two when
+// faces rest on each other, and one when a corner digs in.  Everything else
+// makes one.
+//
+struct contact_manifold {
+	contact_manifold() : normal(ZERO_VECTOR), depth(0.0f), num_points(0) {}
+
+	vector2 normal;			// unit length, pointing from a toward b.
+	float depth;
+	int num_points;
+	vector2 points[MANIFOLD_MAX_POINTS];
+};
+
+// Each returns false, leaving the manifold untouched, when the shapes don't
+// overlap.  Touching follows the same rules as bounding_shape_collides: aligned
+// boxes touching, or a circle touching a box's side, get a contact with no
+// depth.  Other shapes that merely touch have no contacts, and zero radius
+// circles never collide with each other.
+bool collide_manifold(const bbox_oriented &a, const bbox_oriented &b, contact_manifold &manifold_out);
+bool collide_manifold(const bbox_aligned &a, const bbox_aligned &b, contact_manifold &manifold_out);
+bool collide_manifold(const bbox_oriented &a, const bcircle &b, contact_manifold &manifold_out);
+bool collide_manifold(const bcircle &a, const bbox_oriented &b, contact_manifold &manifold_out);
+bool collide_manifold(const bcircle &a, const bcircle &b, contact_manifold &manifold_out);
+bool collide_manifold(const bounding_shape &a, const bounding_shape &b, contact_manifold &manifold_out);
+bool collide_manifold(const bounding_area &a, const bounding_area &b, contact_manifold &manifold_out);
+
+#endif // __MANIFOLD_H
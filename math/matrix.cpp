@@ -2,13 +2,8 @@
 
 void rotate_around_point( const vector2 &pos, const matrix &orient, const vector2 &rotate_around, const matrix &rotation, vector2 &pos_out, matrix &orient_out )
 {
-	matrix rot_inverse = rotation;
-	rot_inverse.invert();
-
-	pos_out = pos;
-	pos_out -= rotate_around;
-	pos_out = pos_out * rot_inverse;
-	pos_out += rotate_around;
+	// pre-multiplying by the inverse is post-multiplying by the rotation.
+	pos_out = (rotation * (pos - rotate_around)) + rotate_around;
 	orient_out = orient;
 
 	orient_out.rotate(rotation.extract_heading());
@@ -16,22 +11,14 @@ void rotate_around_point( const vector2 &pos, const matrix &orient, const vector
 
 void rotate_around_point( const vector2 &pos, const vector2 &rotate_around, const matrix &rotation, vector2 &pos_out)
 {
-	matrix rot_inverse = rotation;
-	rot_inverse.invert();
-
-	pos_out = pos;
-	pos_out -= rotate_around;
-	pos_out = pos_out * rot_inverse;
-	pos_out += rotate_around;
+	pos_out = (rotation * (pos - rotate_around)) + rotate_around;
 }
 
 void world_to_local( const vector2 &pos_in, const matrix &orient_in, const vector2 &local_origin, const matrix &local_origin_orient, vector2 &pos_out, matrix &orient_out )
 {
 	pos_out = pos_in - local_origin;
 	pos_out = pos_out * local_origin_orient;
-	matrix inv = local_origin_orient;
-	inv.invert();
-	orient_out = orient_in * inv;
+	orient_out = orient_in * local_origin_orient.transpose_copy();
 }
 
 void world_to_local(const vector2 &pos_in, const vector2 &local_origin, const matrix &local_origin_orient, vector2 &pos_out)
@@ -42,19 +29,13 @@ void world_to_local(const vector2 &pos_in, const vector2 &local_origin, const ma
 
 void local_to_world( const vector2 &pos_in, const matrix &orient_in, const vector2 &local_origin, const matrix &local_origin_orient, vector2 &pos_out, matrix &orient_out )
 {
-	matrix rotation = local_origin_orient;
-	rotation.invert();
-	pos_out = pos_in * rotation;
-	pos_out += local_origin;
+	pos_out = (local_origin_orient * pos_in) + local_origin;
 	orient_out = orient_in * local_origin_orient;
 }
 
 void local_to_world( const vector2 &pos_in, const vector2 &local_origin, const matrix &local_origin_orient, vector2 &pos_out )
 {
-	matrix rotation = local_origin_orient;
-	rotation.invert();
-	pos_out = pos_in * rotation;
-	pos_out += local_origin;
+	pos_out = (local_origin_orient * pos_in) + local_origin;
 }
 
 void scale_pos( const vector2 &pos_in, const vector2 &scale, vector2 &pos_out )
@@ -82,7 +82,7 @@ public:
 		uvec = new_uvec;
 	}
 
-	inline matrix transpose_copy() {
+	inline matrix transpose_copy() const {
 		return matrix(vector2(rvec.x, uvec.x), vector2(rvec.y, uvec.y));
 	}
 
@@ -96,8 +96,8 @@ public:
 	}
 
 	void rotate(float theta) {
-		float sin = sinf(theta);
-		float cos = cosf(theta);
+		float sin, cos;
+		fl_sincos(theta, sin, cos);
 		matrix rotation(vector2(cos, sin), vector2(-sin, cos));
 		matrix old_orient = *this;
 		*this = rotation * old_orient;
@@ -113,9 +113,11 @@ public:
 		rotate(heading);
 	}
 
+	// For a rotation, the inverse is just the transpose.  fix() keeps it a
+	// rotation, the way rebuilding it from the heading used to.
 	inline void invert() {
-		make_heading(-extract_heading());
-		Assert(uvec.is_normalized() && rvec.is_normalized());
+		transpose();
+		fix();
 	}
 
 	// Something in me doesn't like this...
@@ -139,7 +141,7 @@ public:
 	// Get the heading angle of the matrix.
 	//
 	inline float extract_heading() const {
-		return atan2(rvec.y, rvec.x);
+		return fl_atan2(rvec.y, rvec.x);
 	}
 
 	inline void fix() {
@@ -209,4 +211,4 @@ void scale_pos_and_orient(const vector2 &pos_in, const matrix &orient_in, const
 
 void lerp_matrix(const matrix &from_orient, const matrix &to_orient, const float pct, matrix &orient_out);
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
@@ -0,0 +1,262 @@
+#include "narrowphase.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Atomically add to an int shared between threads.  Compilers without an
+// intrinsic for it fall back to the pool's mutex.
+//
+// returns: the value before the add.
+//
+static inline int narrowphase_fetch_and_add(volatile int *value, int amount, pthread_mutex_t *mutex)
+{
+#if defined(__GNUC__)
+	return __sync_fetch_and_add(value, amount);
+#elif defined(_MSC_VER)
+	return (int)_InterlockedExchangeAdd((volatile long *)value, amount);
+#else
+	pthread_mutex_lock(mutex);
+	int old_value = *value;
+	*value = old_value + amount;
+	pthread_mutex_unlock(mutex);
+	return old_value;
+#endif
+}
+
+// num_threads: number of worker threads to start.  The calling thread works too,
+//		so 0 runs everything on the caller.
+// max_pairs: maximum number of candidate pairs per call.
+//
+narrowphase_pool::narrowphase_pool(int num_threads, int max_pairs)
+{
+	Assert(num_threads >= 0);
+	Assert(max_pairs > 0);
+
+	m_max_pairs = MAX(max_pairs, 1);
+	m_hits = new collision_pair[m_max_pairs];
+	m_manifolds = new contact_manifold[m_max_pairs];
+	m_chunk_hits = new int[(m_max_pairs + NARROWPHASE_CHUNK_SIZE - 1) / NARROWPHASE_CHUNK_SIZE];
+
+	m_shapes = NULL;
+	m_areas = NULL;
+	m_pairs = NULL;
+	m_filters = NULL;
+	m_num_pairs = 0;
+	m_want_manifolds = false;
+	m_num_chunks = 0;
+	m_next_chunk = 0;
+
+	m_generation = 0;
+	m_num_busy = 0;
+	m_quit = false;
+	pthread_mutex_init(&m_mutex, NULL);
+	pthread_cond_init(&m_start_cond, NULL);
+	pthread_cond_init(&m_done_cond, NULL);
+
+	m_num_threads = 0;
+	m_threads = NULL;
+	if (num_threads > 0) {
+		m_threads = new pthread_t[num_threads];
+		for (int i = 0; i < num_threads; i++) {
+			if (pthread_create(&m_threads[m_num_threads], NULL, worker_main, this) != 0) {
+				Assert(!"Failed to start narrowphase worker thread");
+				break;
+			}
+			m_num_threads++;
+		}
+	}
+}
+
+narrowphase_pool::~narrowphase_pool()
+{
+	pthread_mutex_lock(&m_mutex);
+	m_quit = true;
+	pthread_cond_broadcast(&m_start_cond);
+	pthread_mutex_unlock(&m_mutex);
+
+	for (int i = 0; i < m_num_threads; i++) {
+		pthread_join(m_threads[i], NULL);
+	}
+
+	pthread_cond_destroy(&m_done_cond);
+	pthread_cond_destroy(&m_start_cond);
+	pthread_mutex_destroy(&m_mutex);
+
+	if (m_threads) {
+		delete [] m_threads;
+	}
+	delete [] m_hits;
+	delete [] m_manifolds;
+	delete [] m_chunk_hits;
+}
+
+void *narrowphase_pool::worker_main(void *data)
+{
+	narrowphase_pool *pool = (narrowphase_pool*)data;
+	int last_generation = 0;
+
+	pthread_mutex_lock(&pool->m_mutex);
+	while (true) {
+		while (pool->m_generation == last_generation && !pool->m_quit) {
+			pthread_cond_wait(&pool->m_start_cond, &pool->m_mutex);
+		}
+		if (pool->m_quit) {
+			break;
+		}
+		last_generation = pool->m_generation;
+
+		pthread_mutex_unlock(&pool->m_mutex);
+		pool->do_work();
+		pthread_mutex_lock(&pool->m_mutex);
+
+		pool->m_num_busy--;
+		if (pool->m_num_busy == 0) {
+			pthread_cond_signal(&pool->m_done_cond);
+		}
+	}
+	pthread_mutex_unlock(&pool->m_mutex);
+
+	return NULL;
+}
+
+// Claim and run chunks until there are none left.
+//
+void narrowphase_pool::do_work()
+{
+	while (true) {
+		int chunk = narrowphase_fetch_and_add(&m_next_chunk, 1, &m_mutex);
+		if (chunk >= m_num_chunks) {
+			break;
+		}
+		run_chunk(chunk);
+	}
+}
+
+void narrowphase_pool::run_chunk(int chunk)
+{
+	int first = chunk * NARROWPHASE_CHUNK_SIZE;
+	int last = MIN(first + NARROWPHASE_CHUNK_SIZE, m_num_pairs);
+	int num_hits = 0;
+
+	for (int i = first; i < last; i++) {
+		const collision_pair &pair = m_pairs[i];
+		if (m_filters && !collision_filter_passes(m_filters[pair.a], m_filters[pair.b])) {
+			continue;
+		}
+
+		bounding_shape shape_a, shape_b;
+		if (m_shapes) {
+			shape_a = m_shapes[pair.a];
+			shape_b = m_shapes[pair.b];
+		} else {
+			m_areas[pair.a]->get_shape(shape_a);
+			m_areas[pair.b]->get_shape(shape_b);
+		}
+
+		bool hit;
+		if (m_want_manifolds) {
+			hit = collide_manifold(shape_a, shape_b, m_manifolds[first + num_hits]);
+		} else {
+			hit = bounding_shape_collides(shape_a, shape_b);
+		}
+
+		if (hit) {
+			m_hits[first + num_hits] = pair;
+			num_hits++;
+		}
+	}
+
+	m_chunk_hits[chunk] = num_hits;
+}
+
+// Hand the job to the workers, pitch in, then gather the hits in chunk order.
+//
+int narrowphase_pool::run(collision_pair *colliding_out, contact_manifold *manifolds_out, int max_colliding)
+{
+	m_num_chunks = (m_num_pairs + NARROWPHASE_CHUNK_SIZE - 1) / NARROWPHASE_CHUNK_SIZE;
+	m_next_chunk = 0;
+
+	// not worth waking anyone for a single chunk.
+	bool use_workers = m_num_threads > 0 && m_num_chunks > 1;
+	if (use_workers) {
+		pthread_mutex_lock(&m_mutex);
+		m_num_busy = m_num_threads;
+		m_generation++;
+		pthread_cond_broadcast(&m_start_cond);
+		pthread_mutex_unlock(&m_mutex);
+	}
+
+	do_work();
+
+	if (use_workers) {
+		pthread_mutex_lock(&m_mutex);
+		while (m_num_busy > 0) {
+			pthread_cond_wait(&m_done_cond, &m_mutex);
+		}
+		pthread_mutex_unlock(&m_mutex);
+	}
+
+	int num_colliding = 0;
+	for (int chunk = 0; chunk < m_num_chunks; chunk++) {
+		int first = chunk * NARROWPHASE_CHUNK_SIZE;
+		for (int i = 0; i < m_chunk_hits[chunk]; i++) {
+			if (num_colliding >= max_colliding) {
+				return num_colliding;
+			}
+			colliding_out[num_colliding] = m_hits[first + i];
+			if (manifolds_out) {
+				manifolds_out[num_colliding] = m_manifolds[first + i];
+			}
+			num_colliding++;
+		}
+	}
+
+	return num_colliding;
+}
+
+// Test every candidate pair, and report the ones that collide in candidate order.
+//
+// shapes: shapes indexed by the handles in the pairs.
+// pairs: candidate pairs, ie. from a broadphase.
+// colliding_out: receives the pairs that collide.
+// manifolds_out: if not NULL, receives a contact manifold for each colliding
+//		pair.  Touching pairs follow the collision table either way.
+// filters: if not NULL, filters indexed by handle.  Filtered pairs are skipped
+//		without touching their shapes.
+//
+// returns: number of pairs written to colliding_out.
+//
+int narrowphase_pool::collide_pairs(const bounding_shape *shapes, const collision_pair *pairs, int num_pairs,
+	collision_pair *colliding_out, int max_colliding, contact_manifold *manifolds_out /*= NULL*/, const collision_filter *filters /*= NULL*/)
+{
+	Assert_return_value(shapes && pairs && colliding_out, 0);
+	Assert_return_value(num_pairs <= m_max_pairs, 0);
+
+	m_shapes = shapes;
+	m_areas = NULL;
+	m_pairs = pairs;
+	m_filters = filters;
+	m_num_pairs = num_pairs;
+	m_want_manifolds = manifolds_out != NULL;
+
+	return run(colliding_out, manifolds_out, max_colliding);
+}
+
+// As above, with the shapes fetched from areas indexed by the handles in the pairs.
+//
+int narrowphase_pool::collide_pairs(bounding_area *const *areas, const collision_pair *pairs, int num_pairs,
+	collision_pair *colliding_out, int max_colliding, contact_manifold *manifolds_out /*= NULL*/, const collision_filter *filters /*= NULL*/)
+{
+	Assert_return_value(areas && pairs && colliding_out, 0);
+	Assert_return_value(num_pairs <= m_max_pairs, 0);
+
+	m_shapes = NULL;
+	m_areas = areas;
+	m_pairs = pairs;
+	m_filters = filters;
+	m_num_pairs = num_pairs;
+	m_want_manifolds = manifolds_out != NULL;
+
+	return run(colliding_out, manifolds_out, max_colliding);
+}
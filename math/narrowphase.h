@@ -0,0 +1,69 @@
+#ifndef __NARROWPHASE_H
+#define __NARROWPHASE_H
+
+#pragma once
+
+#include <pthread.h>
+
+#include "manifold.h"
+
+// Runs the narrowphase over a list of candidate pairs on a pool of worker threads.
+//
+// The pair list is cut into fixed-size chunks that the workers (and the calling
+// thread) claim one at a time.  Each chunk writes its hits to its own slice of a
+// scratch buffer, and the slices are stitched together in chunk order afterwards,
+// so the colliding pairs come out in the same order as the candidates no matter
+// how many threads ran or how the chunks were shared out.
+//
+// The tests only read the shapes, so no locking is needed around them, but the
+// shapes must not change while the pool is running.
+//
+
+#define NARROWPHASE_CHUNK_SIZE		(256)
+
+class narrowphase_pool {
+	private:
+		pthread_t *m_threads;
+		int m_num_threads;
+
+		pthread_mutex_t m_mutex;
+		pthread_cond_t m_start_cond;
+		pthread_cond_t m_done_cond;
+		int m_generation;
+		int m_num_busy;
+		bool m_quit;
+
+		// the job in progress.
+		const bounding_shape *m_shapes;
+		bounding_area *const *m_areas;
+		const collision_pair *m_pairs;
+		const collision_filter *m_filters;
+		int m_num_pairs;
+		bool m_want_manifolds;
+		int m_num_chunks;
+		volatile int m_next_chunk;
+
+		// scratch, one slice of NARROWPHASE_CHUNK_SIZE per chunk.
+		collision_pair *m_hits;
+		contact_manifold *m_manifolds;
+		int *m_chunk_hits;
+		int m_max_pairs;
+
+		static void *worker_main(void *data);
+		void do_work();
+		void run_chunk(int chunk);
+		int run(collision_pair *colliding_out, contact_manifold *manifolds_out, int max_colliding);
+
+	public:
+		narrowphase_pool(int num_threads, int max_pairs);
+		~narrowphase_pool();
+
+		int collide_pairs(const bounding_shape *shapes, const collision_pair *pairs, int num_pairs,
+			collision_pair *colliding_out, int max_colliding, contact_manifold *manifolds_out = NULL, const collision_filter *filters = NULL);
+		int collide_pairs(bounding_area *const *areas, const collision_pair *pairs, int num_pairs,
+			collision_pair *colliding_out, int max_colliding, contact_manifold *manifolds_out = NULL, const collision_filter *filters = NULL);
+
+		int get_num_threads() const {return m_num_threads;}
+};
+
+#endif // __NARROWPHASE_H
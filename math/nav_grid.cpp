@@ -0,0 +1,529 @@
+#include "nav_grid.h"
+
+#include <cfloat>
+#include <cstring>
+
+#define NAV_DIAGONAL_COST		(1.41421356f)
+
+// Neighbor offsets, straight moves first.
+static const int Nav_neighbor_dx[8] = {1, -1, 0, 0, 1, -1, 1, -1};
+static const int Nav_neighbor_dy[8] = {0, 0, 1, -1, 1, 1, -1, -1};
+
+// bounds: area covered by the grid.  Everything outside it counts as blocked.
+// cell_size: width of a cell.  Smaller cells fit through tighter gaps, but make
+//		for bigger searches.
+//
+nav_grid::nav_grid(const bbox_aligned &bounds, float cell_size)
+{
+	Assert(cell_size > 0.0f);
+
+	m_cell_size = (cell_size > 0.0f) ? cell_size : 1.0f;
+	m_inv_cell_size = 1.0f / m_cell_size;
+	m_min = bounds.bbmin;
+	m_width = MAX((int)ceilf((bounds.bbmax.x - bounds.bbmin.x) * m_inv_cell_size), 1);
+	m_height = MAX((int)ceilf((bounds.bbmax.y - bounds.bbmin.y) * m_inv_cell_size), 1);
+
+	m_cells = new unsigned char[m_width * m_height];
+	clear();
+}
+
+nav_grid::~nav_grid()
+{
+	delete [] m_cells;
+}
+
+void nav_grid::clear()
+{
+	memset(m_cells, NAV_CELL_FREE, m_width * m_height);
+}
+
+// Add or remove an obstacle from the count of every cell touched by an area,
+// grown by the padding.  The padding grows each cell into a square rather than
+// rounding its corners, so it errs on the side of blocking.
+//
+void nav_grid::rasterize(const bounding_area &area, float padding, bool add)
+{
+	bbox_aligned bounds;
+	bounding_area_get_bounds(area, bounds);
+
+	int min_x = MAX((int)floorf((bounds.bbmin.x - padding - m_min.x) * m_inv_cell_size), 0);
+	int min_y = MAX((int)floorf((bounds.bbmin.y - padding - m_min.y) * m_inv_cell_size), 0);
+	int max_x = MIN((int)floorf((bounds.bbmax.x + padding - m_min.x) * m_inv_cell_size), m_width - 1);
+	int max_y = MIN((int)floorf((bounds.bbmax.y + padding - m_min.y) * m_inv_cell_size), m_height - 1);
+
+	bounding_shape shape;
+	area.get_shape(shape);
+
+	bounding_shape cell;
+	cell.type = BAT_BOX_ALIGNED;
+	cell.size = vector2(m_cell_size + (padding * 2.0f), m_cell_size + (padding * 2.0f));
+
+	for (int y = min_y; y <= max_y; y++) {
+		for (int x = min_x; x <= max_x; x++) {
+			cell.center = get_cell_center(x, y);
+			if (!bounding_shape_collides(cell, shape)) {
+				continue;
+			}
+
+			unsigned char &value = m_cells[(y * m_width) + x];
+			int count = value & NAV_CELL_COUNT_MASK;
+			if (add) {
+				Assert_continue(count < NAV_CELL_COUNT_MASK);
+				count++;
+			} else {
+				Assert_continue(count > 0);
+				count--;
+			}
+			value = (value & NAV_CELL_BLOCKED) | count;
+		}
+	}
+}
+
+// Block a single cell by hand, on top of any obstacles.  Unblocking it doesn't
+// free it while obstacles still cover it.
+//
+void nav_grid::set_blocked(int x, int y, bool blocked)
+{
+	Assert_return(x >= 0 && x < m_width && y >= 0 && y < m_height);
+	unsigned char &value = m_cells[(y * m_width) + x];
+	value = blocked ? (value | NAV_CELL_BLOCKED) : (value & NAV_CELL_COUNT_MASK);
+}
+
+bool nav_grid::is_blocked(int x, int y) const
+{
+	if (x < 0 || x >= m_width || y < 0 || y >= m_height) {
+		return true;
+	}
+	return m_cells[(y * m_width) + x] != NAV_CELL_FREE;
+}
+
+// returns: false if the position is outside the grid.
+//
+bool nav_grid::get_cell(const vector2 &pos, int &x_out, int &y_out) const
+{
+	x_out = (int)floorf((pos.x - m_min.x) * m_inv_cell_size);
+	y_out = (int)floorf((pos.y - m_min.y) * m_inv_cell_size);
+	return x_out >= 0 && x_out < m_width && y_out >= 0 && y_out < m_height;
+}
+
+vector2 nav_grid::get_cell_center(int x, int y) const
+{
+	return vector2(m_min.x + ((x + 0.5f) * m_cell_size), m_min.y + ((y + 0.5f) * m_cell_size));
+}
+
+// Walk the cells under a segment.  Where it passes exactly through a corner,
+// both cells beside the corner have to be free, the same as a diagonal step.
+//
+// returns: true if every cell along the way is free.
+//
+bool nav_grid::line_of_sight(const vector2 &a, const vector2 &b) const
+{
+	int x, y, end_x, end_y;
+	if (!get_cell(a, x, y) || !get_cell(b, end_x, end_y) || is_blocked(x, y)) {
+		return false;
+	}
+
+	vector2 delta = b - a;
+	int step_x = 0, step_y = 0;
+	float next_x = FLT_MAX, next_y = FLT_MAX;
+	float delta_x = FLT_MAX, delta_y = FLT_MAX;
+	if (delta.x != 0.0f) {
+		step_x = (delta.x > 0.0f) ? 1 : -1;
+		next_x = (m_min.x + ((x + ((step_x > 0) ? 1 : 0)) * m_cell_size) - a.x) / delta.x;
+		delta_x = m_cell_size / fl_abs(delta.x);
+	}
+	if (delta.y != 0.0f) {
+		step_y = (delta.y > 0.0f) ? 1 : -1;
+		next_y = (m_min.y + ((y + ((step_y > 0) ? 1 : 0)) * m_cell_size) - a.y) / delta.y;
+		delta_y = m_cell_size / fl_abs(delta.y);
+	}
+
+	// rounding can't make the walk longer than this.
+	int steps_left = abs(end_x - x) + abs(end_y - y);
+	while ((x != end_x || y != end_y) && steps_left-- > 0) {
+		if (fl_abs(next_x - next_y) <= 0.000001f) {
+			if (is_blocked(x + step_x, y) || is_blocked(x, y + step_y)) {
+				return false;
+			}
+			x += step_x;
+			y += step_y;
+			next_x += delta_x;
+			next_y += delta_y;
+			steps_left--;
+		} else if (next_x < next_y) {
+			x += step_x;
+			next_x += delta_x;
+		} else {
+			y += step_y;
+			next_y += delta_y;
+		}
+
+		if (is_blocked(x, y)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Pull a path tight, dropping every point that the points on either side of it
+// can see past.
+//
+// returns: number of points left, which are packed to the front of the array.
+//
+int nav_smooth_path(const nav_grid &grid, vector2 *points, int num_points)
+{
+	Assert_return_value(points || num_points == 0, 0);
+	if (num_points <= 2) {
+		return num_points;
+	}
+
+	int num_kept = 1;
+	int anchor = 0;
+	while (anchor < num_points - 1) {
+		int next = anchor + 1;
+		while (next + 1 < num_points && grid.line_of_sight(points[anchor], points[next + 1])) {
+			next++;
+		}
+		points[num_kept++] = points[next];
+		anchor = next;
+	}
+
+	return num_kept;
+}
+
+nav_search::nav_search(const nav_grid *grid)
+{
+	Assert(grid);
+
+	m_grid = grid;
+	m_num_cells = grid->get_width() * grid->get_height();
+
+	m_f = new float[m_num_cells];
+	m_g = new float[m_num_cells];
+	m_parent = new int[m_num_cells];
+	m_path = new vector2[m_num_cells + 1];
+	m_visited = new uint[m_num_cells];
+	m_closed = new uint[m_num_cells];
+	memset(m_visited, 0, sizeof(uint) * m_num_cells);
+	memset(m_closed, 0, sizeof(uint) * m_num_cells);
+	m_search_id = 0;
+
+	nav_compare compare;
+	compare.f = m_f;
+	compare.g = m_g;
+	m_open = new index_heap<nav_compare>(m_num_cells, compare);
+
+	m_status = NAV_SEARCH_IDLE;
+	m_start = m_goal = ZERO_VECTOR;
+	m_start_cell = m_goal_cell = m_found_cell = -1;
+}
+
+nav_search::~nav_search()
+{
+	delete [] m_f;
+	delete [] m_g;
+	delete [] m_parent;
+	delete [] m_path;
+	delete [] m_visited;
+	delete [] m_closed;
+	delete m_open;
+}
+
+// Octile distance to the goal, in cells.
+//
+float nav_search::heuristic(int cell) const
+{
+	int width = m_grid->get_width();
+	int dx = abs((cell % width) - (m_goal_cell % width));
+	int dy = abs((cell / width) - (m_goal_cell / width));
+	return (float)(dx + dy) + ((NAV_DIAGONAL_COST - 2.0f) * (float)MIN(dx, dy));
+}
+
+void nav_search::open_cell(int cell, int parent, float g)
+{
+	m_visited[cell] = m_search_id;
+	m_g[cell] = g;
+	m_f[cell] = g + heuristic(cell);
+	m_parent[cell] = parent;
+	m_open->push(cell);
+}
+
+// Start looking for a path, abandoning any search in progress.
+//
+// returns: NAV_SEARCH_RUNNING, or NAV_SEARCH_FAILED if either end is blocked.
+//
+nav_search_status nav_search::begin(const vector2 &start, const vector2 &goal)
+{
+	m_open->clear();
+	m_start = start;
+	m_goal = goal;
+	m_found_cell = -1;
+
+	// a new id makes every cell unvisited without touching them.
+	m_search_id++;
+	if (m_search_id == 0) {
+		memset(m_visited, 0, sizeof(uint) * m_num_cells);
+		memset(m_closed, 0, sizeof(uint) * m_num_cells);
+		m_search_id = 1;
+	}
+
+	int start_x, start_y, goal_x, goal_y;
+	if (!m_grid->get_cell(start, start_x, start_y) || !m_grid->get_cell(goal, goal_x, goal_y) ||
+		m_grid->is_blocked(start_x, start_y) || m_grid->is_blocked(goal_x, goal_y)) {
+		m_status = NAV_SEARCH_FAILED;
+		return m_status;
+	}
+
+	int width = m_grid->get_width();
+	m_start_cell = (start_y * width) + start_x;
+	m_goal_cell = (goal_y * width) + goal_x;
+
+	open_cell(m_start_cell, -1, 0.0f);
+	m_status = NAV_SEARCH_RUNNING;
+	return m_status;
+}
+
+// Run the search for a while.
+//
+// max_expansions: most cells to expand before returning.
+// num_expanded_out: receives how many were actually expanded.  May be NULL.
+//
+// returns: NAV_SEARCH_RUNNING if it isn't done yet, or the final result.
+//
+nav_search_status nav_search::step(int max_expansions, int *num_expanded_out /*= NULL*/)
+{
+	int width = m_grid->get_width();
+	int num_expanded = 0;
+
+	while (m_status == NAV_SEARCH_RUNNING && num_expanded < max_expansions) {
+		if (m_open->empty()) {
+			m_status = NAV_SEARCH_FAILED;
+			break;
+		}
+
+		int cell = m_open->pop();
+		m_closed[cell] = m_search_id;
+		num_expanded++;
+
+		if (cell == m_goal_cell) {
+			m_found_cell = cell;
+			m_status = NAV_SEARCH_FOUND;
+			break;
+		}
+
+		int x = cell % width;
+		int y = cell / width;
+		for (int i = 0; i < 8; i++) {
+			int nx = x + Nav_neighbor_dx[i];
+			int ny = y + Nav_neighbor_dy[i];
+			if (m_grid->is_blocked(nx, ny)) {
+				continue;
+			}
+
+			// no squeezing diagonally between two blocked cells, or around a corner.
+			bool diagonal = Nav_neighbor_dx[i] != 0 && Nav_neighbor_dy[i] != 0;
+			if (diagonal && (m_grid->is_blocked(nx, y) || m_grid->is_blocked(x, ny))) {
+				continue;
+			}
+
+			int neighbor = (ny * width) + nx;
+			if (m_closed[neighbor] == m_search_id) {
+				continue;
+			}
+
+			float g = m_g[cell] + (diagonal ? NAV_DIAGONAL_COST : 1.0f);
+			if (m_visited[neighbor] != m_search_id || g < m_g[neighbor]) {
+				open_cell(neighbor, cell, g);
+			}
+		}
+	}
+
+	if (num_expanded_out) {
+		*num_expanded_out = num_expanded;
+	}
+	return m_status;
+}
+
+// Read back the path found by the last search.  It runs from the exact start to
+// the exact goal, through the centers of the cells in between.
+//
+// smooth: pull the path tight with nav_smooth_path().
+//
+// returns: number of points written.  A path longer than max_points is cut short,
+//		keeping the start.
+//
+int nav_search::get_path(vector2 *points_out, int max_points, bool smooth /*= true*/)
+{
+	Assert_return_value(points_out, 0);
+	if (m_status != NAV_SEARCH_FOUND) {
+		return 0;
+	}
+
+	// walk back from the goal, filling the scratch path from the back.
+	int num_points = 0;
+	for (int cell = m_found_cell; cell >= 0; cell = m_parent[cell]) {
+		num_points++;
+	}
+
+	int width = m_grid->get_width();
+	int index = num_points;
+	for (int cell = m_found_cell; cell >= 0; cell = m_parent[cell]) {
+		m_path[--index] = m_grid->get_cell_center(cell % width, cell / width);
+	}
+
+	// the end cells are swapped for the real endpoints.  A path within one cell
+	// still needs both.
+	m_path[0] = m_start;
+	if (num_points == 1) {
+		num_points++;
+	}
+	m_path[num_points - 1] = m_goal;
+
+	if (smooth) {
+		num_points = nav_smooth_path(*m_grid, m_path, num_points);
+	}
+
+	num_points = MIN(num_points, max_points);
+	for (int i = 0; i < num_points; i++) {
+		points_out[i] = m_path[i];
+	}
+	return num_points;
+}
+
+// Find a path in one go.
+//
+// returns: number of points written to points_out, or 0 if there's no path.
+//
+int nav_search::find_path(const vector2 &start, const vector2 &goal, vector2 *points_out, int max_points, bool smooth /*= true*/)
+{
+	if (begin(start, goal) == NAV_SEARCH_RUNNING) {
+		step(m_num_cells);
+	}
+	return get_path(points_out, max_points, smooth);
+}
+
+// grid: the grid to search.  It has to outlive the queue.
+// max_requests: most requests that can be waiting or finished but unreleased.
+// max_points: longest path kept per request.
+// smooth: pull paths tight with nav_smooth_path().
+//
+nav_path_queue::nav_path_queue(const nav_grid *grid, int max_requests, int max_points, bool smooth /*= true*/)
+{
+	Assert(max_requests > 0);
+	Assert(max_points >= 2);
+
+	m_search = new nav_search(grid);
+	m_requests = new static_pool<nav_path_request>(MAX(max_requests, 1), NAV_QUEUE_NUM_LISTS);
+	m_current = NULL;
+
+	m_max_points = MAX(max_points, 2);
+	m_points = new vector2[m_requests->num_items * m_max_points];
+	m_smooth = smooth;
+
+	for (int i = 0; i < m_requests->num_items; i++) {
+		m_requests->master_list[i].points = &m_points[i * m_max_points];
+	}
+}
+
+nav_path_queue::~nav_path_queue()
+{
+	delete m_search;
+	delete m_requests;
+	delete [] m_points;
+}
+
+// Queue up a path search.
+//
+// returns: handle for checking on the request, or -1 if the queue is full.
+//
+int nav_path_queue::request(const vector2 &start, const vector2 &goal)
+{
+	nav_path_request *request = m_requests->alloc(NAV_QUEUE_WAITING);
+	if (request == NULL) {
+		return -1;
+	}
+
+	request->start = start;
+	request->goal = goal;
+	request->status = NAV_SEARCH_RUNNING;
+	request->num_points = 0;
+	return m_requests->get_index(request);
+}
+
+void nav_path_queue::finish_current()
+{
+	m_current->status = m_search->get_status();
+	m_current->num_points = m_search->get_path(m_current->points, m_max_points, m_smooth);
+
+	DL_DELETE(m_requests->used_lists[NAV_QUEUE_WAITING], m_current);
+	DL_APPEND(m_requests->used_lists[NAV_QUEUE_DONE], m_current);
+	m_current = NULL;
+}
+
+// Work through the queue, oldest request first.  Call once a frame.
+//
+// max_expansions: budget of cells to expand, shared by as many requests as it
+//		takes to use it up.  A search that runs out carries on next time.
+//
+void nav_path_queue::update(int max_expansions)
+{
+	int budget = max_expansions;
+	while (budget > 0) {
+		if (m_current == NULL) {
+			m_current = m_requests->used_lists[NAV_QUEUE_WAITING];
+			if (m_current == NULL) {
+				break;
+			}
+
+			// failing at the start still costs something, so a flood of bad
+			// requests can't stall the frame.
+			budget--;
+			if (m_search->begin(m_current->start, m_current->goal) != NAV_SEARCH_RUNNING) {
+				finish_current();
+				continue;
+			}
+		}
+
+		int num_expanded = 0;
+		if (m_search->step(budget, &num_expanded) != NAV_SEARCH_RUNNING) {
+			finish_current();
+		}
+		budget -= num_expanded;
+	}
+}
+
+// Forget a request, finished or not.  Its handle may be reused afterwards.
+//
+void nav_path_queue::release(int handle)
+{
+	Assert_return(handle >= 0 && handle < m_requests->num_items);
+	nav_path_request *request = &m_requests->master_list[handle];
+	Assert_return(request->status != NAV_SEARCH_IDLE);
+
+	if (request == m_current) {
+		m_current = NULL;
+	}
+
+	m_requests->free(request, (request->status == NAV_SEARCH_RUNNING) ? NAV_QUEUE_WAITING : NAV_QUEUE_DONE);
+	request->status = NAV_SEARCH_IDLE;
+	request->num_points = 0;
+}
+
+// returns: NAV_SEARCH_RUNNING while the request is waiting or being searched.
+//
+nav_search_status nav_path_queue::get_status(int handle) const
+{
+	Assert_return_value(handle >= 0 && handle < m_requests->num_items, NAV_SEARCH_IDLE);
+	return m_requests->master_list[handle].status;
+}
+
+// returns: number of points in the request's path, or 0 if it isn't found (yet).
+//
+int nav_path_queue::get_path(int handle, const vector2 **points_out) const
+{
+	Assert_return_value(handle >= 0 && handle < m_requests->num_items && points_out, 0);
+	const nav_path_request &request = m_requests->master_list[handle];
+	*points_out = request.points;
+	return (request.status == NAV_SEARCH_FOUND) ? request.num_points : 0;
+}
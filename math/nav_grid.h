@@ -0,0 +1,163 @@
+#ifndef __NAV_GRID_H
+#define __NAV_GRID_H
+
+#pragma once
+
+#include "bbox.h"
+#include "../structures/index_heap.h"
+#include "../structures/static_pool.h"
+
+// Grid pathfinding around obstacles.
+//
+// nav_grid holds which cells are blocked.  Obstacles are baked in from any
+// bounding_area, optionally padded by an agent's radius.  Each cell counts the
+// obstacles covering it, so obstacles can overlap and be removed in any order.
+//
+// nav_search is an A* search over a nav_grid, moving in eight directions without
+// cutting corners.  Everything it needs is allocated up front, sized to the grid,
+// and reused between searches, so finding a path never allocates.  A search can
+// run to completion, or a limited number of nodes at a time.
+//
+// nav_path_queue shares one nav_search between many agents, running queued
+// requests in order within a per-frame budget of nodes.
+//
+
+// A cell is blocked if any of it is set.
+#define NAV_CELL_FREE			(0)
+#define NAV_CELL_BLOCKED		(0x80)		// set by set_blocked.
+#define NAV_CELL_COUNT_MASK		(0x7f)		// number of obstacles covering the cell.
+
+class nav_grid {
+	private:
+		unsigned char *m_cells;
+		vector2 m_min;
+		float m_cell_size;
+		float m_inv_cell_size;
+		int m_width;
+		int m_height;
+
+		void rasterize(const bounding_area &area, float padding, bool add);
+
+	public:
+		nav_grid(const bbox_aligned &bounds, float cell_size);
+		~nav_grid();
+
+		// remove with the same area and padding it was added with.
+		void add_obstacle(const bounding_area &area, float padding = 0.0f) {rasterize(area, padding, true);}
+		void remove_obstacle(const bounding_area &area, float padding = 0.0f) {rasterize(area, padding, false);}
+		void clear();
+
+		void set_blocked(int x, int y, bool blocked);
+		bool is_blocked(int x, int y) const;
+		bool line_of_sight(const vector2 &a, const vector2 &b) const;
+
+		bool get_cell(const vector2 &pos, int &x_out, int &y_out) const;
+		vector2 get_cell_center(int x, int y) const;
+
+		int get_width() const {return m_width;}
+		int get_height() const {return m_height;}
+		float get_cell_size() const {return m_cell_size;}
+};
+
+enum nav_search_status {
+	NAV_SEARCH_IDLE,
+	NAV_SEARCH_RUNNING,
+	NAV_SEARCH_FOUND,
+	NAV_SEARCH_FAILED,
+};
+
+// Orders the open list by estimated total cost, breaking ties toward the goal.
+struct nav_compare {
+	nav_compare() : f(NULL), g(NULL) {}
+
+	const float *f;
+	const float *g;
+
+	bool operator () (int a, int b) const {
+		return (f[a] < f[b]) || (f[a] == f[b] && g[a] > g[b]);
+	}
+};
+
+class nav_search {
+	private:
+		const nav_grid *m_grid;
+		int m_num_cells;
+
+		// per cell, only valid where m_visited matches the current search.
+		float *m_f;
+		float *m_g;
+		int *m_parent;
+		vector2 *m_path;
+		uint *m_visited;
+		uint *m_closed;
+		uint m_search_id;
+
+		index_heap<nav_compare> *m_open;
+
+		nav_search_status m_status;
+		vector2 m_start;
+		vector2 m_goal;
+		int m_start_cell;
+		int m_goal_cell;
+		int m_found_cell;
+
+		float heuristic(int cell) const;
+		void open_cell(int cell, int parent, float g);
+
+	public:
+		nav_search(const nav_grid *grid);
+		~nav_search();
+
+		nav_search_status begin(const vector2 &start, const vector2 &goal);
+		nav_search_status step(int max_expansions, int *num_expanded_out = NULL);
+		nav_search_status get_status() const {return m_status;}
+		int get_path(vector2 *points_out, int max_points, bool smooth = true);
+
+		int find_path(const vector2 &start, const vector2 &goal, vector2 *points_out, int max_points, bool smooth = true);
+};
+
+int nav_smooth_path(const nav_grid &grid, vector2 *points, int num_points);
+
+// A path request waiting in, or finished by, a nav_path_queue.
+struct nav_path_request {
+	nav_path_request() : start(ZERO_VECTOR), goal(ZERO_VECTOR), status(NAV_SEARCH_IDLE), points(NULL), num_points(0), prev(NULL), next(NULL) {}
+
+	vector2 start;
+	vector2 goal;
+	nav_search_status status;
+	vector2 *points;				// points into the queue's path storage.
+	int num_points;
+
+	nav_path_request *prev, *next;
+};
+
+// Used lists in a nav_path_queue's request pool.
+#define NAV_QUEUE_WAITING		(0)
+#define NAV_QUEUE_DONE			(1)
+#define NAV_QUEUE_NUM_LISTS		(2)
+
+class nav_path_queue {
+	private:
+		nav_search *m_search;
+		static_pool<nav_path_request> *m_requests;
+		nav_path_request *m_current;
+
+		vector2 *m_points;
+		int m_max_points;
+		bool m_smooth;
+
+		void finish_current();
+
+	public:
+		nav_path_queue(const nav_grid *grid, int max_requests, int max_points, bool smooth = true);
+		~nav_path_queue();
+
+		int request(const vector2 &start, const vector2 &goal);
+		void update(int max_expansions);
+		void release(int handle);
+
+		nav_search_status get_status(int handle) const;
+		int get_path(int handle, const vector2 **points_out) const;
+};
+
+#endif // __NAV_GRID_H
@@ -0,0 +1,257 @@
+#include "pair_cache.h"
+
+#include "../ss.h"
+
+#define PAIR_CACHE_HASH_PRIME_A		(73856093u)
+#define PAIR_CACHE_HASH_PRIME_B		(19349663u)
+#define PAIR_CACHE_AXIS_TOLERANCE	(0.0001f)		// relative to the distances involved
+
+static inline bool pair_cache_shapes_equal(const bounding_shape &a, const bounding_shape &b)
+{
+	return a.type == b.type && a.center == b.center && a.size == b.size &&
+		a.orient.rvec == b.orient.rvec && a.orient.uvec == b.orient.uvec;
+}
+
+// Half the length of the shape's projection onto a unit axis.
+//
+static inline float pair_cache_project_radius(const bounding_shape &shape, const vector2 &axis)
+{
+	if (shape.type == BAT_CIRCLE) {
+		return shape.size.x;
+	}
+
+	return fl_abs(shape.orient.rvec.dot(axis)) * fl_abs(shape.size.x) * 0.5f +
+		fl_abs(shape.orient.uvec.dot(axis)) * fl_abs(shape.size.y) * 0.5f;
+}
+
+// Only a clear gap counts as separating.  Whether touching shapes collide depends
+// on the pair (aligned boxes and a circle on a box's side do, as in
+// bounding_shape_collides), and a projection onto a diagonal axis can round
+// either way, so pairs that touch or nearly do fall through to collide_manifold.
+//
+static inline bool pair_cache_axis_separates(const bounding_shape &a, const bounding_shape &b, const vector2 &axis)
+{
+	float dist = fl_abs((b.center - a.center).dot(axis));
+	float radius = pair_cache_project_radius(a, axis) + pair_cache_project_radius(b, axis);
+	return dist - radius > (dist + radius) * PAIR_CACHE_AXIS_TOLERANCE;
+}
+
+// Look for an axis that separates the shapes.  For boxes these are the usual SAT
+// axes.  Where there's a circle, the only axis that matters runs from the closest
+// point on the other shape to the circle's center.
+//
+// returns: false if the shapes overlap.
+//
+static bool pair_cache_find_separating_axis(const bounding_shape &a, const bounding_shape &b, vector2 &axis_out)
+{
+	bool a_is_circle = a.type == BAT_CIRCLE;
+	bool b_is_circle = b.type == BAT_CIRCLE;
+
+	if (a_is_circle && b_is_circle) {
+		axis_out = (b.center - a.center).copy_normalize_safe(RIGHT_VECTOR);
+		return pair_cache_axis_separates(a, b, axis_out);
+	}
+
+	if (a_is_circle || b_is_circle) {
+		const bounding_shape &box = a_is_circle ? b : a;
+		const bounding_shape &circle = a_is_circle ? a : b;
+
+		vector2 local_center;
+		world_to_local(circle.center, box.center, box.orient, local_center);
+
+		vector2 half_size(fl_abs(box.size.x) * 0.5f, fl_abs(box.size.y) * 0.5f);
+		vector2 closest(fl_cap(local_center.x, -half_size.x, half_size.x), fl_cap(local_center.y, -half_size.y, half_size.y));
+
+		// the circle's center is inside the box.
+		if (closest == local_center) {
+			return false;
+		}
+
+		axis_out = box.orient * (local_center - closest).copy_normalize_safe(RIGHT_VECTOR);
+		return pair_cache_axis_separates(a, b, axis_out);
+	}
+
+	const vector2 *axes[4] = {&a.orient.rvec, &a.orient.uvec, &b.orient.rvec, &b.orient.uvec};
+	for (int i = 0; i < 4; i++) {
+		if (pair_cache_axis_separates(a, b, *axes[i])) {
+			axis_out = *axes[i];
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// max_pairs: maximum number of pairs remembered at once.  Pairs beyond this are
+//		still tested, just not cached.
+// num_buckets: number of hash buckets for looking up pairs.
+//
+pair_cache::pair_cache(int max_pairs, int num_buckets)
+{
+	Assert(max_pairs > 0);
+	m_pairs = new static_pool<pair_cache_entry>(MAX(max_pairs, 1), MAX(num_buckets, 1));
+}
+
+pair_cache::~pair_cache()
+{
+	if (m_pairs) {
+		delete m_pairs;
+	}
+}
+
+int pair_cache::get_bucket(int a, int b) const
+{
+	uint hash = ((uint)a * PAIR_CACHE_HASH_PRIME_A) ^ ((uint)b * PAIR_CACHE_HASH_PRIME_B);
+	return (int)(hash % (uint)m_pairs->num_used_lists);
+}
+
+pair_cache_entry *pair_cache::find(int handle_a, int handle_b) const
+{
+	if (handle_a > handle_b) {
+		SWAP(handle_a, handle_b, int);
+	}
+
+	pair_cache_entry *entry = NULL;
+	DL_FOREACH(m_pairs->used_lists[get_bucket(handle_a, handle_b)], entry) {
+		if (entry->a == handle_a && entry->b == handle_b) {
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+bool pair_cache::collide_sorted(int handle_a, const bounding_shape &a, int handle_b, const bounding_shape &b, contact_manifold *manifold_out)
+{
+	pair_cache_entry *entry = find(handle_a, handle_b);
+
+	if (entry) {
+		// nothing moved, so nothing changed.
+		if (pair_cache_shapes_equal(entry->shape_a, a) && pair_cache_shapes_equal(entry->shape_b, b)) {
+			entry->last_used_ms = Game_time_ms;
+			if (entry->colliding && manifold_out) {
+				*manifold_out = entry->manifold;
+			}
+			return entry->colliding;
+		}
+
+		// still apart along the same axis as last time.
+		if (!entry->colliding && entry->separating_axis != ZERO_VECTOR &&
+			pair_cache_axis_separates(a, b, entry->separating_axis)) {
+			entry->shape_a = a;
+			entry->shape_b = b;
+			entry->last_used_ms = Game_time_ms;
+			return false;
+		}
+	}
+
+	vector2 separating_axis = ZERO_VECTOR;
+	contact_manifold manifold;
+	bool colliding = false;
+	if (!pair_cache_find_separating_axis(a, b, separating_axis)) {
+		separating_axis = ZERO_VECTOR;
+		colliding = collide_manifold(a, b, manifold);
+	}
+
+	if (entry == NULL) {
+		// if the cache is full, the pair just goes uncached.
+		entry = m_pairs->alloc(get_bucket(handle_a, handle_b));
+		if (entry) {
+			entry->a = handle_a;
+			entry->b = handle_b;
+		}
+	}
+
+	if (entry) {
+		entry->shape_a = a;
+		entry->shape_b = b;
+		entry->colliding = colliding;
+		entry->separating_axis = separating_axis;
+		entry->manifold = manifold;
+		entry->last_used_ms = Game_time_ms;
+	}
+
+	if (colliding && manifold_out) {
+		*manifold_out = manifold;
+	}
+	return colliding;
+}
+
+// Narrowphase test for a pair of shapes, through the cache.
+//
+// handle_a, handle_b: caller's ids for the shapes, typically their broadphase handles.
+// manifold_out: receives the contact manifold if the shapes collide.  May be NULL.
+//
+// returns: true if the shapes overlap.
+//
+bool pair_cache::collide(int handle_a, const bounding_shape &a, int handle_b, const bounding_shape &b, contact_manifold *manifold_out /*= NULL*/)
+{
+	Assert_return_value(handle_a != handle_b, false);
+
+	if (handle_a < handle_b) {
+		return collide_sorted(handle_a, a, handle_b, b, manifold_out);
+	}
+
+	// the cache stores the normal from the lower handle to the higher one.
+	if (!collide_sorted(handle_b, b, handle_a, a, manifold_out)) {
+		return false;
+	}
+	if (manifold_out) {
+		manifold_out->normal = -manifold_out->normal;
+	}
+	return true;
+}
+
+bool pair_cache::collide(int handle_a, const bounding_area &a, int handle_b, const bounding_area &b, contact_manifold *manifold_out /*= NULL*/)
+{
+	bounding_shape shape_a, shape_b;
+	a.get_shape(shape_a);
+	b.get_shape(shape_b);
+
+	return collide(handle_a, shape_a, handle_b, shape_b, manifold_out);
+}
+
+// Forget every pair involving a handle, ie. when its shape is destroyed.
+//
+void pair_cache::remove(int handle)
+{
+	for (int bucket = 0; bucket < m_pairs->num_used_lists; bucket++) {
+		pair_cache_entry *entry = NULL, *next_entry = NULL;
+		DL_FOREACH_DELETE_SAFE(m_pairs->used_lists[bucket], entry, next_entry) {
+			if (entry->a == handle || entry->b == handle) {
+				m_pairs->free(entry, bucket);
+			}
+		}
+	}
+}
+
+// Forget pairs that haven't been tested recently.  Call once a frame or so, after
+// the narrowphase.
+//
+// max_age_ms: pairs not tested for longer than this are evicted.
+//
+// returns: number of pairs evicted.
+//
+int pair_cache::evict_stale(int max_age_ms)
+{
+	int num_evicted = 0;
+	for (int bucket = 0; bucket < m_pairs->num_used_lists; bucket++) {
+		pair_cache_entry *entry = NULL, *next_entry = NULL;
+		DL_FOREACH_DELETE_SAFE(m_pairs->used_lists[bucket], entry, next_entry) {
+			if (Game_time_ms - entry->last_used_ms > max_age_ms) {
+				m_pairs->free(entry, bucket);
+				num_evicted++;
+			}
+		}
+	}
+	return num_evicted;
+}
+
+void pair_cache::clear()
+{
+	for (int bucket = 0; bucket < m_pairs->num_used_lists; bucket++) {
+		pair_cache_entry *entry = NULL, *next_entry = NULL;
+		DL_FOREACH_DELETE_SAFE(m_pairs->used_lists[bucket], entry, next_entry) {
+			m_pairs->free(entry, bucket);
+		}
+	}
+}
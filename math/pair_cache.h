@@ -0,0 +1,62 @@
+#ifndef __PAIR_CACHE_H
+#define __PAIR_CACHE_H
+
+#pragma once
+
+#include "manifold.h"
+#include "../structures/static_pool.h"
+
+// Remembers the result of the narrowphase for each pair of shapes between frames,
+// so stable pairs don't pay for a full test every frame.
+//
+// - If neither shape changed since the pair was last tested, the last result is
+//   reused outright.
+// - If the pair was apart, the axis that separated them is tried first.  Shapes
+//   rarely move far in one frame, so it usually still separates them.
+// - Otherwise the full test runs, and its separating axis or manifold is kept
+//   for next time.
+//
+// Each pair is stamped with Game_time_ms when tested, so pairs that drop out of
+// the broadphase can be evicted once they go stale.
+//
+
+struct pair_cache_entry {
+	pair_cache_entry() : a(-1), b(-1), colliding(false), separating_axis(ZERO_VECTOR), last_used_ms(0), prev(NULL), next(NULL) {}
+
+	int a;							// lower handle.
+	int b;
+	bounding_shape shape_a;			// shapes as of the last test.
+	bounding_shape shape_b;
+
+	bool colliding;
+	vector2 separating_axis;		// valid when not colliding.
+	contact_manifold manifold;		// valid when colliding, with the normal from a to b.
+
+	int last_used_ms;
+
+	pair_cache_entry *prev, *next;
+};
+
+class pair_cache {
+	private:
+		static_pool<pair_cache_entry> *m_pairs;
+
+		int get_bucket(int a, int b) const;
+		bool collide_sorted(int handle_a, const bounding_shape &a, int handle_b, const bounding_shape &b, contact_manifold *manifold_out);
+
+	public:
+		pair_cache(int max_pairs, int num_buckets);
+		~pair_cache();
+
+		bool collide(int handle_a, const bounding_shape &a, int handle_b, const bounding_shape &b, contact_manifold *manifold_out = NULL);
+		bool collide(int handle_a, const bounding_area &a, int handle_b, const bounding_area &b, contact_manifold *manifold_out = NULL);
+
+		pair_cache_entry *find(int handle_a, int handle_b) const;
+		void remove(int handle);
+		int evict_stale(int max_age_ms);
+		void clear();
+
+		int get_num_pairs() const {return m_pairs->num_items - m_pairs->num_free;}
+};
+
+#endif // __PAIR_CACHE_H
@@ -0,0 +1,498 @@
+#include "quadtree.h"
+
+// Depth is capped well below this, and each node visited leaves at most three
+// siblings waiting on the stack.
+#define QUADTREE_STACK_SIZE		(64)
+
+static inline int quadtree_child_index(const quadtree_node *node, const vector2 &pt)
+{
+	return ((pt.x >= node->center.x) ? 1 : 0) | ((pt.y >= node->center.y) ? 2 : 0);
+}
+
+static inline bool quadtree_cell_contains(const quadtree_node *node, const vector2 &pt)
+{
+	return pt.x >= node->center.x - node->half_size && pt.x < node->center.x + node->half_size &&
+		pt.y >= node->center.y - node->half_size && pt.y < node->center.y + node->half_size;
+}
+
+// Squared distance from a point to a box, or 0 if it's inside.
+static inline float quadtree_dist_sq(const vector2 &bbmin, const vector2 &bbmax, const vector2 &pt)
+{
+	float dx = MAX(bbmin.x - pt.x, 0.0f);
+	dx = MAX(dx, pt.x - bbmax.x);
+	float dy = MAX(bbmin.y - pt.y, 0.0f);
+	dy = MAX(dy, pt.y - bbmax.y);
+	return SQUARED(dx) + SQUARED(dy);
+}
+
+static inline float quadtree_loose_dist_sq(const quadtree_node *node, const vector2 &pt)
+{
+	float loose = node->half_size * 2.0f;
+	float dx = MAX(fl_abs(pt.x - node->center.x) - loose, 0.0f);
+	float dy = MAX(fl_abs(pt.y - node->center.y) - loose, 0.0f);
+	return SQUARED(dx) + SQUARED(dy);
+}
+
+// world_bounds: area the tree subdivides.  Objects outside it still work, but
+//		are all kept in the root.
+// max_depth: deepest level of subdivision, up to QUADTREE_MAX_DEPTH.
+// max_objects: maximum number of objects in the tree at once.
+// max_nodes: size of the node pool.  When it runs out, objects are kept in
+//		shallower nodes, which is still correct, just slower to query.
+//
+quadtree::quadtree(const bbox_aligned &world_bounds, int max_depth, int max_objects, int max_nodes)
+{
+	Assert(max_depth >= 0 && max_depth <= QUADTREE_MAX_DEPTH);
+	Assert(max_objects > 0);
+	Assert(max_nodes > 0);
+
+	m_max_depth = MAX(0, MIN(max_depth, QUADTREE_MAX_DEPTH));
+
+	m_nodes = new static_pool<quadtree_node>(MAX(max_nodes, 1));
+	m_heap = new quadtree_node*[m_nodes->num_items];
+	m_heap_dist_sq = new float[m_nodes->num_items];
+
+	m_root = m_nodes->alloc();
+	m_root->center = (world_bounds.bbmin + world_bounds.bbmax) * 0.5f;
+	m_root->half_size = MAX(fl_abs(world_bounds.bbmax.x - world_bounds.bbmin.x), fl_abs(world_bounds.bbmax.y - world_bounds.bbmin.y)) * 0.5f;
+
+	m_max_objects = MAX(max_objects, 1);
+	m_objects = new quadtree_object[m_max_objects];
+	m_nearest_dist_sq = new float[m_max_objects];
+	for (int i = 0; i < m_max_objects - 1; i++) {
+		m_objects[i].next_free = i + 1;
+	}
+	m_objects[m_max_objects - 1].next_free = -1;
+	m_first_free = 0;
+	m_num_objects = 0;
+}
+
+quadtree::~quadtree()
+{
+	delete m_nodes;
+	delete [] m_heap;
+	delete [] m_heap_dist_sq;
+	delete [] m_objects;
+	delete [] m_nearest_dist_sq;
+}
+
+// The deepest level whose cells are at least as big as the object.
+//
+int quadtree::get_depth(const vector2 &center, const vector2 &half_extent) const
+{
+	if (!quadtree_cell_contains(m_root, center)) {
+		return 0;
+	}
+
+	float size = MAX(half_extent.x, half_extent.y);
+	float half_size = m_root->half_size;
+	int depth = 0;
+	while (depth < m_max_depth && half_size * 0.5f >= size) {
+		half_size *= 0.5f;
+		depth++;
+	}
+	return depth;
+}
+
+quadtree_node *quadtree::alloc_child(quadtree_node *node, int child)
+{
+	quadtree_node *new_node = m_nodes->alloc();
+	if (new_node == NULL) {
+		return NULL;
+	}
+
+	float half_size = node->half_size * 0.5f;
+	new_node->center.x = node->center.x + ((child & 1) ? half_size : -half_size);
+	new_node->center.y = node->center.y + ((child & 2) ? half_size : -half_size);
+	new_node->half_size = half_size;
+	new_node->depth = node->depth + 1;
+	new_node->parent = node;
+	new_node->children[0] = new_node->children[1] = new_node->children[2] = new_node->children[3] = NULL;
+	new_node->objects = NULL;
+	new_node->num_objects = 0;
+
+	node->children[child] = new_node;
+	return new_node;
+}
+
+void quadtree::insert(quadtree_object &obj)
+{
+	vector2 center = (obj.bbmin + obj.bbmax) * 0.5f;
+	int depth = get_depth(center, (obj.bbmax - obj.bbmin) * 0.5f);
+
+	quadtree_node *node = m_root;
+	while (node->depth < depth) {
+		int child = quadtree_child_index(node, center);
+		if (node->children[child] == NULL && alloc_child(node, child) == NULL) {
+			break;
+		}
+		node = node->children[child];
+	}
+
+	obj.node = node;
+	DL_APPEND(node->objects, &obj);
+	for (quadtree_node *parent = node; parent; parent = parent->parent) {
+		parent->num_objects++;
+	}
+}
+
+void quadtree::unlink(quadtree_object &obj)
+{
+	quadtree_node *node = obj.node;
+	Assert_return(node);
+
+	DL_DELETE(node->objects, &obj);
+	obj.node = NULL;
+	for (quadtree_node *parent = node; parent; parent = parent->parent) {
+		parent->num_objects--;
+	}
+
+	// give back nodes with nothing left in them.
+	while (node != m_root && node->num_objects == 0) {
+		quadtree_node *parent = node->parent;
+		for (int i = 0; i < 4; i++) {
+			if (parent->children[i] == node) {
+				parent->children[i] = NULL;
+			}
+		}
+		m_nodes->free(node);
+		node = parent;
+	}
+}
+
+// Start tracking a box.  The tree keeps its own copy of the bounds.
+//
+// data: anything the caller wants to associate with the box.
+//
+// returns: handle used to refer to the box, or -1 if the tree is full.
+//
+int quadtree::add(const bbox_aligned &bounds, void *data /*= NULL*/)
+{
+	Assert_return_value(m_first_free >= 0, -1);
+
+	int handle = m_first_free;
+	quadtree_object &obj = m_objects[handle];
+	m_first_free = obj.next_free;
+	m_num_objects++;
+
+	obj.bbmin.x = MIN(bounds.bbmin.x, bounds.bbmax.x);
+	obj.bbmin.y = MIN(bounds.bbmin.y, bounds.bbmax.y);
+	obj.bbmax.x = MAX(bounds.bbmin.x, bounds.bbmax.x);
+	obj.bbmax.y = MAX(bounds.bbmin.y, bounds.bbmax.y);
+	obj.data = data;
+	obj.next_free = -1;
+	insert(obj);
+
+	return handle;
+}
+
+void quadtree::remove(int handle)
+{
+	Assert_return(handle >= 0 && handle < m_max_objects);
+	quadtree_object &obj = m_objects[handle];
+	Assert_return(obj.node);
+
+	unlink(obj);
+	obj.data = NULL;
+	obj.next_free = m_first_free;
+	m_first_free = handle;
+	m_num_objects--;
+}
+
+// Translate a box.  It only changes nodes if its center leaves its cell.
+//
+void quadtree::move(int handle, const vector2 &delta)
+{
+	Assert_return(handle >= 0 && handle < m_max_objects);
+	quadtree_object &obj = m_objects[handle];
+	Assert_return(obj.node);
+
+	obj.bbmin += delta;
+	obj.bbmax += delta;
+
+	// the depth only depends on the size, so it can only be out of its cell.
+	if (obj.node == m_root || quadtree_cell_contains(obj.node, (obj.bbmin + obj.bbmax) * 0.5f)) {
+		// something in the root that's moved inside the world may be able to go deeper.
+		if (obj.node != m_root || get_depth((obj.bbmin + obj.bbmax) * 0.5f, (obj.bbmax - obj.bbmin) * 0.5f) == 0) {
+			return;
+		}
+	}
+
+	unlink(obj);
+	insert(obj);
+}
+
+// Replace a box's bounds, ie. when it changes size.
+//
+void quadtree::update(int handle, const bbox_aligned &bounds)
+{
+	Assert_return(handle >= 0 && handle < m_max_objects);
+	quadtree_object &obj = m_objects[handle];
+	Assert_return(obj.node);
+
+	obj.bbmin.x = MIN(bounds.bbmin.x, bounds.bbmax.x);
+	obj.bbmin.y = MIN(bounds.bbmin.y, bounds.bbmax.y);
+	obj.bbmax.x = MAX(bounds.bbmin.x, bounds.bbmax.x);
+	obj.bbmax.y = MAX(bounds.bbmin.y, bounds.bbmax.y);
+
+	vector2 center = (obj.bbmin + obj.bbmax) * 0.5f;
+	if (get_depth(center, (obj.bbmax - obj.bbmin) * 0.5f) == obj.node->depth &&
+		(obj.node == m_root || quadtree_cell_contains(obj.node, center))) {
+		return;
+	}
+
+	unlink(obj);
+	insert(obj);
+}
+
+void quadtree::get_bounds(int handle, bbox_aligned &bounds_out) const
+{
+	Assert_return(handle >= 0 && handle < m_max_objects);
+	bounds_out.bbmin = m_objects[handle].bbmin;
+	bounds_out.bbmax = m_objects[handle].bbmax;
+}
+
+void *quadtree::get_data(int handle) const
+{
+	Assert_return_value(handle >= 0 && handle < m_max_objects, NULL);
+	return m_objects[handle].data;
+}
+
+// Find every box containing a point, edges included.
+//
+// returns: number of handles written to handles_out.
+//
+int quadtree::query(const vector2 &pt, int *handles_out, int max_handles) const
+{
+	Assert_return_value(handles_out, 0);
+
+	const quadtree_node *stack[QUADTREE_STACK_SIZE];
+	int stack_size = 0;
+	int num_found = 0;
+
+	stack[stack_size++] = m_root;
+	while (stack_size > 0) {
+		const quadtree_node *node = stack[--stack_size];
+
+		quadtree_object *obj = NULL;
+		DL_FOREACH(node->objects, obj) {
+			if (pt.x < obj->bbmin.x || pt.x > obj->bbmax.x || pt.y < obj->bbmin.y || pt.y > obj->bbmax.y) {
+				continue;
+			}
+			if (num_found >= max_handles) {
+				return num_found;
+			}
+			handles_out[num_found++] = (int)(obj - m_objects);
+		}
+
+		for (int i = 0; i < 4; i++) {
+			const quadtree_node *child = node->children[i];
+			if (child == NULL) {
+				continue;
+			}
+			float loose = child->half_size * 2.0f;
+			if (pt.x < child->center.x - loose || pt.x > child->center.x + loose ||
+				pt.y < child->center.y - loose || pt.y > child->center.y + loose) {
+				continue;
+			}
+			Assert_break(stack_size < QUADTREE_STACK_SIZE);
+			stack[stack_size++] = child;
+		}
+	}
+
+	return num_found;
+}
+
+// Find every box overlapping a region, edges included.
+//
+// returns: number of handles written to handles_out.
+//
+int quadtree::query(const bbox_aligned &bounds, int *handles_out, int max_handles) const
+{
+	Assert_return_value(handles_out, 0);
+
+	vector2 bbmin(MIN(bounds.bbmin.x, bounds.bbmax.x), MIN(bounds.bbmin.y, bounds.bbmax.y));
+	vector2 bbmax(MAX(bounds.bbmin.x, bounds.bbmax.x), MAX(bounds.bbmin.y, bounds.bbmax.y));
+	vector2 center = (bbmin + bbmax) * 0.5f;
+	vector2 half_extent = (bbmax - bbmin) * 0.5f;
+
+	const quadtree_node *stack[QUADTREE_STACK_SIZE];
+	int stack_size = 0;
+	int num_found = 0;
+
+	stack[stack_size++] = m_root;
+	while (stack_size > 0) {
+		const quadtree_node *node = stack[--stack_size];
+
+		quadtree_object *obj = NULL;
+		DL_FOREACH(node->objects, obj) {
+			if (obj->bbmax.x < bbmin.x || bbmax.x < obj->bbmin.x || obj->bbmax.y < bbmin.y || bbmax.y < obj->bbmin.y) {
+				continue;
+			}
+			if (num_found >= max_handles) {
+				return num_found;
+			}
+			handles_out[num_found++] = (int)(obj - m_objects);
+		}
+
+		for (int i = 0; i < 4; i++) {
+			const quadtree_node *child = node->children[i];
+			if (child == NULL) {
+				continue;
+			}
+			float loose = child->half_size * 2.0f;
+			if (fl_abs(center.x - child->center.x) > loose + half_extent.x ||
+				fl_abs(center.y - child->center.y) > loose + half_extent.y) {
+				continue;
+			}
+			Assert_break(stack_size < QUADTREE_STACK_SIZE);
+			stack[stack_size++] = child;
+		}
+	}
+
+	return num_found;
+}
+
+// Find every box that comes within a circle's radius of its center.
+//
+// returns: number of handles written to handles_out.
+//
+int quadtree::query(const bcircle &circle, int *handles_out, int max_handles) const
+{
+	Assert_return_value(handles_out, 0);
+
+	float radius_sq = SQUARED(circle.radius);
+
+	const quadtree_node *stack[QUADTREE_STACK_SIZE];
+	int stack_size = 0;
+	int num_found = 0;
+
+	stack[stack_size++] = m_root;
+	while (stack_size > 0) {
+		const quadtree_node *node = stack[--stack_size];
+
+		quadtree_object *obj = NULL;
+		DL_FOREACH(node->objects, obj) {
+			if (quadtree_dist_sq(obj->bbmin, obj->bbmax, circle.center) > radius_sq) {
+				continue;
+			}
+			if (num_found >= max_handles) {
+				return num_found;
+			}
+			handles_out[num_found++] = (int)(obj - m_objects);
+		}
+
+		for (int i = 0; i < 4; i++) {
+			const quadtree_node *child = node->children[i];
+			if (child == NULL || quadtree_loose_dist_sq(child, circle.center) > radius_sq) {
+				continue;
+			}
+			Assert_break(stack_size < QUADTREE_STACK_SIZE);
+			stack[stack_size++] = child;
+		}
+	}
+
+	return num_found;
+}
+
+// Find the k boxes closest to a point, nearest first.  Nodes are searched in order
+// of distance, and the search stops once the next node is farther than the kth
+// best box so far.
+//
+// handles_out: receives up to k handles.
+// dist_sq_out: if not NULL, receives the squared distance to each box, 0 if the
+//		point is inside it.
+//
+// returns: number of handles found, fewer than k if the tree has fewer objects.
+//
+int quadtree::query_nearest(const vector2 &pt, int *handles_out, int k, float *dist_sq_out /*= NULL*/)
+{
+	Assert_return_value(handles_out && k > 0, 0);
+
+	// there can't be more results than objects.
+	k = MIN(k, m_max_objects);
+	float *dists = dist_sq_out ? dist_sq_out : m_nearest_dist_sq;
+	int num_found = 0;
+
+	// min-heap of nodes by distance to their loose bounds.
+	int heap_size = 0;
+	m_heap[heap_size] = m_root;
+	m_heap_dist_sq[heap_size] = 0.0f;
+	heap_size++;
+
+	while (heap_size > 0) {
+		quadtree_node *node = m_heap[0];
+		float node_dist_sq = m_heap_dist_sq[0];
+
+		// pop.
+		heap_size--;
+		int index = 0;
+		while (true) {
+			int child = index * 2 + 1;
+			if (child >= heap_size) {
+				break;
+			}
+			if (child + 1 < heap_size && m_heap_dist_sq[child + 1] < m_heap_dist_sq[child]) {
+				child++;
+			}
+			if (m_heap_dist_sq[heap_size] <= m_heap_dist_sq[child]) {
+				break;
+			}
+			m_heap[index] = m_heap[child];
+			m_heap_dist_sq[index] = m_heap_dist_sq[child];
+			index = child;
+		}
+		m_heap[index] = m_heap[heap_size];
+		m_heap_dist_sq[index] = m_heap_dist_sq[heap_size];
+
+		if (num_found == k && node_dist_sq > dists[k - 1]) {
+			break;
+		}
+
+		// insertion sort each object into the results.
+		quadtree_object *obj = NULL;
+		DL_FOREACH(node->objects, obj) {
+			float dist_sq = quadtree_dist_sq(obj->bbmin, obj->bbmax, pt);
+			if (num_found == k && dist_sq >= dists[k - 1]) {
+				continue;
+			}
+
+			int slot = (num_found < k) ? num_found++ : k - 1;
+			while (slot > 0 && dists[slot - 1] > dist_sq) {
+				handles_out[slot] = handles_out[slot - 1];
+				dists[slot] = dists[slot - 1];
+				slot--;
+			}
+			handles_out[slot] = (int)(obj - m_objects);
+			dists[slot] = dist_sq;
+		}
+
+		for (int i = 0; i < 4; i++) {
+			quadtree_node *child = node->children[i];
+			if (child == NULL) {
+				continue;
+			}
+			float child_dist_sq = quadtree_loose_dist_sq(child, pt);
+			if (num_found == k && child_dist_sq > dists[k - 1]) {
+				continue;
+			}
+
+			// push.
+			Assert_break(heap_size < m_nodes->num_items);
+			int index = heap_size++;
+			while (index > 0) {
+				int parent = (index - 1) / 2;
+				if (m_heap_dist_sq[parent] <= child_dist_sq) {
+					break;
+				}
+				m_heap[index] = m_heap[parent];
+				m_heap_dist_sq[index] = m_heap_dist_sq[parent];
+				index = parent;
+			}
+			m_heap[index] = child;
+			m_heap_dist_sq[index] = child_dist_sq;
+		}
+	}
+
+	return num_found;
+}
@@ -0,0 +1,96 @@
+#ifndef __QUADTREE_H
+#define __QUADTREE_H
+
+#pragma once
+
+#include "bbox.h"
+#include "../structures/static_pool.h"
+
+// A loose quadtree of bbox_aligned bounds, for point, region and nearest-neighbor
+// queries.
+//
+// Each node's loose bounds are twice the size of its cell, so an object is stored
+// in the single node at the depth matching its size, in the cell holding its
+// center.  Nothing is ever split across nodes, and an object that moves only
+// changes nodes when its center leaves its cell.
+//
+// Objects centered outside the world bounds live in the root, which every query
+// checks.  Nodes come from a static_pool and are freed again once empty.
+//
+
+#define QUADTREE_MAX_DEPTH		(16)
+
+struct quadtree_object;
+
+struct quadtree_node {
+	quadtree_node() : center(ZERO_VECTOR), half_size(0.0f), depth(0), parent(NULL), objects(NULL), num_objects(0), prev(NULL), next(NULL)
+	{
+		children[0] = children[1] = children[2] = children[3] = NULL;
+	}
+
+	vector2 center;
+	float half_size;				// half the width of the cell.  The loose bounds are twice the cell.
+	int depth;
+
+	quadtree_node *parent;
+	quadtree_node *children[4];		// indexed by (x >= center.x) | ((y >= center.y) << 1)
+
+	quadtree_object *objects;
+	int num_objects;				// in this node and everything below it
+
+	quadtree_node *prev, *next;
+};
+
+struct quadtree_object {
+	quadtree_object() : node(NULL), data(NULL), next_free(-1), prev(NULL), next(NULL) {}
+
+	vector2 bbmin;
+	vector2 bbmax;
+	quadtree_node *node;			// NULL while free
+	void *data;
+
+	int next_free;
+	quadtree_object *prev, *next;
+};
+
+class quadtree {
+	private:
+		static_pool<quadtree_node> *m_nodes;
+		quadtree_node *m_root;
+		int m_max_depth;
+
+		quadtree_object *m_objects;
+		int m_max_objects;
+		int m_first_free;
+		int m_num_objects;
+
+		// scratch for nearest-neighbor searches.
+		quadtree_node **m_heap;
+		float *m_heap_dist_sq;
+		float *m_nearest_dist_sq;
+
+		int get_depth(const vector2 &center, const vector2 &half_extent) const;
+		void insert(quadtree_object &obj);
+		void unlink(quadtree_object &obj);
+		quadtree_node *alloc_child(quadtree_node *node, int child);
+
+	public:
+		quadtree(const bbox_aligned &world_bounds, int max_depth, int max_objects, int max_nodes);
+		~quadtree();
+
+		int add(const bbox_aligned &bounds, void *data = NULL);
+		void remove(int handle);
+		void move(int handle, const vector2 &delta);
+		void update(int handle, const bbox_aligned &bounds);
+
+		void get_bounds(int handle, bbox_aligned &bounds_out) const;
+		void *get_data(int handle) const;
+		int get_num_objects() const {return m_num_objects;}
+
+		int query(const vector2 &pt, int *handles_out, int max_handles) const;
+		int query(const bbox_aligned &bounds, int *handles_out, int max_handles) const;
+		int query(const bcircle &circle, int *handles_out, int max_handles) const;
+		int query_nearest(const vector2 &pt, int *handles_out, int k, float *dist_sq_out = NULL);
+};
+
+#endif // __QUADTREE_H
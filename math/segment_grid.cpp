@@ -0,0 +1,370 @@
+#include "segment_grid.h"
+
+#include <cfloat>
+#include <cstring>
+
+static inline float segment_grid_cross(const vector2 &a, const vector2 &b)
+{
+	return (a.x * b.y) - (a.y * b.x);
+}
+
+// Clip a segment against a box.
+//
+// returns: true if any of the segment is inside the box, edges included.
+//
+static bool segment_grid_touches_box(const vector2 &start, const vector2 &delta, const vector2 &bbmin, const vector2 &bbmax)
+{
+	float t_min = 0.0f;
+	float t_max = 1.0f;
+
+	for (int axis = 0; axis < 2; axis++) {
+		float s = (axis == 0) ? start.x : start.y;
+		float d = (axis == 0) ? delta.x : delta.y;
+		float lo = (axis == 0) ? bbmin.x : bbmin.y;
+		float hi = (axis == 0) ? bbmax.x : bbmax.y;
+
+		if (d == 0.0f) {
+			if (s < lo || s > hi) {
+				return false;
+			}
+			continue;
+		}
+
+		float t1 = (lo - s) / d;
+		float t2 = (hi - s) / d;
+		t_min = MAX(t_min, MIN(t1, t2));
+		t_max = MIN(t_max, MAX(t1, t2));
+		if (t_min > t_max) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// segs: the segments to index.  They're copied, so the array can go away afterwards.
+//		Handles reported in hits are indices into this array.
+// num_segs: number of segments.
+// cell_size: width of a grid cell.  Around the length of a typical segment works
+//		well.  It's grown if the grid would otherwise have more than
+//		SEGMENT_GRID_MAX_CELLS cells.
+//
+segment_grid::segment_grid(const line_segment *segs, int num_segs, float cell_size)
+{
+	Assert(num_segs >= 0 && (segs || num_segs == 0));
+	Assert(cell_size > 0.0f);
+
+	m_num_segs = MAX(num_segs, 0);
+	m_seg_start = new vector2[MAX(m_num_segs, 1)];
+	m_seg_delta = new vector2[MAX(m_num_segs, 1)];
+
+	m_min = ZERO_VECTOR;
+	vector2 max = ZERO_VECTOR;
+	for (int i = 0; i < m_num_segs; i++) {
+		m_seg_start[i] = segs[i].a;
+		m_seg_delta[i] = segs[i].b - segs[i].a;
+
+		if (i == 0) {
+			m_min = max = segs[i].a;
+		}
+		m_min.x = MIN(m_min.x, MIN(segs[i].a.x, segs[i].b.x));
+		m_min.y = MIN(m_min.y, MIN(segs[i].a.y, segs[i].b.y));
+		max.x = MAX(max.x, MAX(segs[i].a.x, segs[i].b.x));
+		max.y = MAX(max.y, MAX(segs[i].a.y, segs[i].b.y));
+	}
+
+	m_cell_size = (cell_size > 0.0f) ? cell_size : 1.0f;
+	while (true) {
+		float width = floorf((max.x - m_min.x) / m_cell_size) + 1.0f;
+		float height = floorf((max.y - m_min.y) / m_cell_size) + 1.0f;
+		if (width * height <= (float)SEGMENT_GRID_MAX_CELLS) {
+			m_width = (int)width;
+			m_height = (int)height;
+			break;
+		}
+		m_cell_size *= 2.0f;
+	}
+	m_inv_cell_size = 1.0f / m_cell_size;
+
+	int num_cells = m_width * m_height;
+	m_cell_start = new int[num_cells + 1];
+	memset(m_cell_start, 0, sizeof(int) * (num_cells + 1));
+
+	// a segment running right through a corner goes in all four cells around it,
+	// so a ray stepping past the corner can't miss it.
+	float slop = m_cell_size * 0.001f;
+
+	// count the segments in each cell, turn the counts into offsets, then fill
+	// the cells in.
+	for (int pass = 0; pass < 2; pass++) {
+		if (pass == 1) {
+			for (int i = 0; i < num_cells; i++) {
+				m_cell_start[i + 1] += m_cell_start[i];
+			}
+			m_cell_segs = new int[MAX(m_cell_start[num_cells], 1)];
+		}
+
+		for (int seg = 0; seg < m_num_segs; seg++) {
+			vector2 a = m_seg_start[seg];
+			vector2 b = a + m_seg_delta[seg];
+			int min_x = MAX((int)floorf((MIN(a.x, b.x) - slop - m_min.x) * m_inv_cell_size), 0);
+			int min_y = MAX((int)floorf((MIN(a.y, b.y) - slop - m_min.y) * m_inv_cell_size), 0);
+			int max_x = MIN((int)floorf((MAX(a.x, b.x) + slop - m_min.x) * m_inv_cell_size), m_width - 1);
+			int max_y = MIN((int)floorf((MAX(a.y, b.y) + slop - m_min.y) * m_inv_cell_size), m_height - 1);
+
+			for (int y = min_y; y <= max_y; y++) {
+				for (int x = min_x; x <= max_x; x++) {
+					vector2 cell_min(m_min.x + (x * m_cell_size) - slop, m_min.y + (y * m_cell_size) - slop);
+					vector2 cell_max(cell_min.x + m_cell_size + (slop * 2.0f), cell_min.y + m_cell_size + (slop * 2.0f));
+					if (!segment_grid_touches_box(a, m_seg_delta[seg], cell_min, cell_max)) {
+						continue;
+					}
+
+					int cell = (y * m_width) + x;
+					if (pass == 0) {
+						m_cell_start[cell + 1]++;
+					} else {
+						m_cell_segs[m_cell_start[cell]++] = seg;
+					}
+				}
+			}
+		}
+	}
+
+	// filling in moved each offset to the end of its cell, which is the start of
+	// the next one.
+	for (int i = num_cells; i > 0; i--) {
+		m_cell_start[i] = m_cell_start[i - 1];
+	}
+	m_cell_start[0] = 0;
+}
+
+segment_grid::~segment_grid()
+{
+	delete [] m_seg_start;
+	delete [] m_seg_delta;
+	delete [] m_cell_start;
+	delete [] m_cell_segs;
+}
+
+// Where a ray crosses one segment.  A ray running along a segment hits it where
+// it first touches it.
+//
+// returns: true if it hits within max_dist.
+//
+bool segment_grid::intersect(int seg, const vector2 &start, const vector2 &dir, float max_dist, float &dist_out) const
+{
+	const vector2 &delta = m_seg_delta[seg];
+	vector2 to_seg = m_seg_start[seg] - start;
+	float denom = segment_grid_cross(dir, delta);
+
+	if (denom == 0.0f) {
+		// parallel, and not on the same line.
+		if (segment_grid_cross(to_seg, dir) != 0.0f) {
+			return false;
+		}
+
+		float dist_a = to_seg.dot(dir);
+		float dist_b = (to_seg + delta).dot(dir);
+		if (MAX(dist_a, dist_b) < 0.0f) {
+			return false;
+		}
+		dist_out = MAX(MIN(dist_a, dist_b), 0.0f);
+		return dist_out <= max_dist;
+	}
+
+	float dist = segment_grid_cross(to_seg, delta) / denom;
+	float s = segment_grid_cross(to_seg, dir) / denom;
+	if (dist < 0.0f || dist > max_dist || s < 0.0f || s > 1.0f) {
+		return false;
+	}
+
+	dist_out = dist;
+	return true;
+}
+
+// Cast a ray against the segments.
+//
+// ray: where to start, and a unit direction.
+// max_dist: how far along the ray to look.
+// hit_out: receives the hit, or a hit with index -1 on a miss.  May be NULL.
+// any_hit: stop at the first hit found rather than looking for the nearest, for
+//		when all that matters is whether something's in the way.
+//
+// returns: true if the ray hit a segment.
+//
+bool segment_grid::cast(const line &ray, float max_dist, segment_hit *hit_out /*= NULL*/, bool any_hit /*= false*/) const
+{
+	Assert(ray.dir.is_normalized());
+
+	if (hit_out) {
+		*hit_out = segment_hit();
+	}
+	if (m_num_segs == 0 || max_dist < 0.0f) {
+		return false;
+	}
+
+	const vector2 &start = ray.start;
+	const vector2 &dir = ray.dir;
+
+	// clip the ray to the grid.
+	vector2 grid_max(m_min.x + (m_width * m_cell_size), m_min.y + (m_height * m_cell_size));
+	float t_enter = 0.0f;
+	float t_end = max_dist;
+	for (int axis = 0; axis < 2; axis++) {
+		float s = (axis == 0) ? start.x : start.y;
+		float d = (axis == 0) ? dir.x : dir.y;
+		float lo = (axis == 0) ? m_min.x : m_min.y;
+		float hi = (axis == 0) ? grid_max.x : grid_max.y;
+
+		if (d == 0.0f) {
+			if (s < lo || s > hi) {
+				return false;
+			}
+			continue;
+		}
+
+		float t1 = (lo - s) / d;
+		float t2 = (hi - s) / d;
+		t_enter = MAX(t_enter, MIN(t1, t2));
+		t_end = MIN(t_end, MAX(t1, t2));
+	}
+	if (t_enter > t_end) {
+		return false;
+	}
+
+	// set up the walk from the first cell the ray touches.
+	vector2 entry = start + (dir * t_enter);
+	int x = MAX(0, MIN((int)floorf((entry.x - m_min.x) * m_inv_cell_size), m_width - 1));
+	int y = MAX(0, MIN((int)floorf((entry.y - m_min.y) * m_inv_cell_size), m_height - 1));
+
+	int step_x = 0, step_y = 0;
+	float next_x = FLT_MAX, next_y = FLT_MAX;
+	float delta_x = FLT_MAX, delta_y = FLT_MAX;
+	if (dir.x != 0.0f) {
+		step_x = (dir.x > 0.0f) ? 1 : -1;
+		next_x = (m_min.x + ((x + ((step_x > 0) ? 1 : 0)) * m_cell_size) - start.x) / dir.x;
+		delta_x = m_cell_size / fl_abs(dir.x);
+	}
+	if (dir.y != 0.0f) {
+		step_y = (dir.y > 0.0f) ? 1 : -1;
+		next_y = (m_min.y + ((y + ((step_y > 0) ? 1 : 0)) * m_cell_size) - start.y) / dir.y;
+		delta_y = m_cell_size / fl_abs(dir.y);
+	}
+
+	// segments that span cells would otherwise be tested again in each one.
+	int tested[SEGMENT_GRID_MAILBOX_SIZE];
+	for (int i = 0; i < SEGMENT_GRID_MAILBOX_SIZE; i++) {
+		tested[i] = -1;
+	}
+
+	int best_seg = -1;
+	float best_dist = max_dist;
+
+	while (true) {
+		int cell = (y * m_width) + x;
+		for (int i = m_cell_start[cell]; i < m_cell_start[cell + 1]; i++) {
+			int seg = m_cell_segs[i];
+			int slot = seg & (SEGMENT_GRID_MAILBOX_SIZE - 1);
+			if (tested[slot] == seg) {
+				continue;
+			}
+			tested[slot] = seg;
+
+			float dist;
+			if (intersect(seg, start, dir, best_dist, dist) && (best_seg < 0 || dist < best_dist)) {
+				best_seg = seg;
+				best_dist = dist;
+				if (any_hit) {
+					break;
+				}
+			}
+		}
+
+		// nothing in a later cell can be closer than a hit inside this one.
+		float cell_exit = MIN(next_x, next_y);
+		if ((best_seg >= 0 && (any_hit || best_dist <= cell_exit)) || cell_exit > t_end) {
+			break;
+		}
+
+		if (next_x < next_y) {
+			x += step_x;
+			next_x += delta_x;
+			if (x < 0 || x >= m_width) {
+				break;
+			}
+		} else {
+			y += step_y;
+			next_y += delta_y;
+			if (y < 0 || y >= m_height) {
+				break;
+			}
+		}
+	}
+
+	if (best_seg < 0) {
+		return false;
+	}
+
+	if (hit_out) {
+		hit_out->dist = best_dist;
+		hit_out->point = start + (dir * best_dist);
+		hit_out->index = best_seg;
+	}
+	return true;
+}
+
+// As above, for a segment from a to b, ie. a line of sight check.
+//
+bool segment_grid::cast(const line_segment &seg, segment_hit *hit_out /*= NULL*/, bool any_hit /*= false*/) const
+{
+	vector2 delta = seg.b - seg.a;
+	float len = delta.mag();
+	if (len == 0.0f) {
+		if (hit_out) {
+			*hit_out = segment_hit();
+		}
+		return false;
+	}
+
+	return cast(line(seg.a, delta / len), len, hit_out, any_hit);
+}
+
+// Cast a batch of rays.
+//
+// max_dists: how far to look along each ray.  If NULL, the rays are unlimited.
+// hits_out: receives a hit for each ray, with index -1 for a miss.  May be NULL
+//		if only the count matters.
+//
+// returns: number of rays that hit something.
+//
+int segment_grid::cast_rays(const line *rays, const float *max_dists, int num_rays, segment_hit *hits_out, bool any_hit /*= false*/) const
+{
+	Assert_return_value(rays || num_rays == 0, 0);
+
+	int num_hits = 0;
+	for (int i = 0; i < num_rays; i++) {
+		float max_dist = max_dists ? max_dists[i] : FLT_MAX;
+		if (cast(rays[i], max_dist, hits_out ? &hits_out[i] : NULL, any_hit)) {
+			num_hits++;
+		}
+	}
+	return num_hits;
+}
+
+// Cast a batch of segments, ie. line of sight checks from many agents.
+//
+// returns: number of segments that hit something.
+//
+int segment_grid::cast_segments(const line_segment *segs, int num_segs, segment_hit *hits_out, bool any_hit /*= false*/) const
+{
+	Assert_return_value(segs || num_segs == 0, 0);
+
+	int num_hits = 0;
+	for (int i = 0; i < num_segs; i++) {
+		if (cast(segs[i], hits_out ? &hits_out[i] : NULL, any_hit)) {
+			num_hits++;
+		}
+	}
+	return num_hits;
+}
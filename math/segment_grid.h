@@ -0,0 +1,63 @@
+#ifndef __SEGMENT_GRID_H
+#define __SEGMENT_GRID_H
+
+#pragma once
+
+#include "bbox.h"
+
+// A static index over line_segments, ie. level walls, for casting lots of rays
+// against them.
+//
+// The segments are bucketed into a uniform grid once at creation, and each cell's
+// list of segments is packed into one shared array.  A ray walks the cells it
+// crosses in order and stops as soon as it has a hit closer than the far side of
+// the current cell, so it only looks at segments near its path.
+//
+// Casting doesn't modify the grid, so any number of threads can cast at once.
+//
+
+#define SEGMENT_GRID_MAX_CELLS			(1 << 20)
+#define SEGMENT_GRID_MAILBOX_SIZE		(16)		// must be a power of two
+
+// Where a ray hit a segment.
+struct segment_hit {
+	segment_hit() : dist(0.0f), point(ZERO_VECTOR), index(-1) {}
+
+	float dist;						// distance along the ray.
+	vector2 point;
+	int index;						// index of the segment hit, or -1 for a miss.
+};
+
+class segment_grid {
+	private:
+		// the segments, as a start point and the offset to the end point.
+		vector2 *m_seg_start;
+		vector2 *m_seg_delta;
+		int m_num_segs;
+
+		vector2 m_min;
+		float m_cell_size;
+		float m_inv_cell_size;
+		int m_width;
+		int m_height;
+
+		// the segments in cell i are m_cell_segs[m_cell_start[i]] up to m_cell_segs[m_cell_start[i + 1]].
+		int *m_cell_start;
+		int *m_cell_segs;
+
+		bool intersect(int seg, const vector2 &start, const vector2 &dir, float max_dist, float &dist_out) const;
+
+	public:
+		segment_grid(const line_segment *segs, int num_segs, float cell_size);
+		~segment_grid();
+
+		bool cast(const line &ray, float max_dist, segment_hit *hit_out = NULL, bool any_hit = false) const;
+		bool cast(const line_segment &seg, segment_hit *hit_out = NULL, bool any_hit = false) const;
+		int cast_rays(const line *rays, const float *max_dists, int num_rays, segment_hit *hits_out, bool any_hit = false) const;
+		int cast_segments(const line_segment *segs, int num_segs, segment_hit *hits_out, bool any_hit = false) const;
+
+		int get_num_segments() const {return m_num_segs;}
+		float get_cell_size() const {return m_cell_size;}
+};
+
+#endif // __SEGMENT_GRID_H
@@ -1,10 +1,82 @@
 #include "spline.h"
 
+#include <cfloat>
 #include <cmath>
+#include <cstring>
 #include <memory>
 
 #include "../gr.h"
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+// Samples buffered up before evaluating them in a batch.
+#define SPLINE_EVAL_BATCH		(64)
+
+// A hermite segment expanded into a cubic, so a point is ((a*u + b)*u + c)*u + d.
+struct hermite_cubic {
+	vector2 a, b, c, d;
+};
+
+static void hermite_cubic_init(hermite_cubic &cubic, const vector2 &pk1, const vector2 &pk2, const vector2 &slope1, const vector2 &slope2)
+{
+	cubic.a = (pk1 * 2.0f) - (pk2 * 2.0f) + slope1 + slope2;
+	cubic.b = (pk2 * 3.0f) - (pk1 * 3.0f) - (slope1 * 2.0f) - slope2;
+	cubic.c = slope1;
+	cubic.d = pk1;
+}
+
+// Evaluate a cubic at each of the u values, eight or four at a time where the
+// compiler allows.
+//
+static void hermite_cubic_evaluate(const hermite_cubic &cubic, const float *u_vals, int count, vector2 *points_out)
+{
+	int i = 0;
+	float *out = &points_out[0].x;
+
+#if defined(__AVX__)
+	const __m256 ax = _mm256_set1_ps(cubic.a.x), ay = _mm256_set1_ps(cubic.a.y);
+	const __m256 bx = _mm256_set1_ps(cubic.b.x), by = _mm256_set1_ps(cubic.b.y);
+	const __m256 cx = _mm256_set1_ps(cubic.c.x), cy = _mm256_set1_ps(cubic.c.y);
+	const __m256 dx = _mm256_set1_ps(cubic.d.x), dy = _mm256_set1_ps(cubic.d.y);
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 u = _mm256_loadu_ps(u_vals + i);
+		__m256 x = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(ax, u), bx), u), cx), u), dx);
+		__m256 y = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(ay, u), by), u), cy), u), dy);
+
+		// interleave back into x y pairs.  unpack works within each half.
+		__m256 lo = _mm256_unpacklo_ps(x, y);
+		__m256 hi = _mm256_unpackhi_ps(x, y);
+		_mm256_storeu_ps(out + (i * 2), _mm256_permute2f128_ps(lo, hi, 0x20));
+		_mm256_storeu_ps(out + (i * 2) + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+	}
+#elif defined(__SSE__)
+	const __m128 ax = _mm_set1_ps(cubic.a.x), ay = _mm_set1_ps(cubic.a.y);
+	const __m128 bx = _mm_set1_ps(cubic.b.x), by = _mm_set1_ps(cubic.b.y);
+	const __m128 cx = _mm_set1_ps(cubic.c.x), cy = _mm_set1_ps(cubic.c.y);
+	const __m128 dx = _mm_set1_ps(cubic.d.x), dy = _mm_set1_ps(cubic.d.y);
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 u = _mm_loadu_ps(u_vals + i);
+		__m128 x = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(ax, u), bx), u), cx), u), dx);
+		__m128 y = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(ay, u), by), u), cy), u), dy);
+
+		_mm_storeu_ps(out + (i * 2), _mm_unpacklo_ps(x, y));
+		_mm_storeu_ps(out + (i * 2) + 4, _mm_unpackhi_ps(x, y));
+	}
+#endif
+
+	for (; i < count; i++) {
+		float u = u_vals[i];
+		points_out[i].x = (((cubic.a.x * u) + cubic.b.x) * u + cubic.c.x) * u + cubic.d.x;
+		points_out[i].y = (((cubic.a.y * u) + cubic.b.y) * u + cubic.c.y) * u + cubic.d.y;
+	}
+}
+
 //function definitions for spline class
 
 spline::spline(int max_points, int num_points /* = 0 */, bool has_color /* = false */)
@@ -20,6 +92,11 @@ spline::spline(int max_points, int num_points /* = 0 */, bool has_color /* = fal
 	m_points = new vector2[m_max_points];
 	m_lengths = new float[m_max_points];
 	m_tangents = new vector2[m_max_points];
+	m_arc_lengths = new float[m_max_points * SPLINE_ARC_STEPS];
+	m_arc_seg_start = new float[m_max_points];
+	m_arc_dirty = new bool[m_max_points];
+	m_seg_min = new vector2[m_max_points];
+	m_seg_max = new vector2[m_max_points];
 	if (has_color) {
 		m_colors = new uint[m_max_points];
 	} else {
@@ -29,6 +106,11 @@ spline::spline(int max_points, int num_points /* = 0 */, bool has_color /* = fal
 	memset(m_lengths, 0, sizeof(float) * num_points);
 	memset(&m_spline_flags, 0, sizeof(m_spline_flags));
 
+	for (int i = 0; i < m_max_points; i++) {
+		m_arc_dirty[i] = true;
+	}
+	m_arc_any_dirty = true;
+
 	if (m_colors) {
 		for (int i = 0; i < m_num_points; i++) {
 			m_colors[i] = 0xFFFFFFFF;
@@ -50,11 +132,21 @@ spline::~spline()
 	if (m_colors) {
 		delete [] m_colors;
 	}
+	delete [] m_arc_lengths;
+	delete [] m_arc_seg_start;
+	delete [] m_arc_dirty;
+	delete [] m_seg_min;
+	delete [] m_seg_max;
 }
 
 void spline::set_tension( float tension )
 {
 	m_tension = tension;
+
+	for (int i = 0; i < m_max_points; i++) {
+		m_arc_dirty[i] = true;
+	}
+	m_arc_any_dirty = true;
 }
 
 void spline::add_point( vector2 new_pt )
@@ -69,6 +161,7 @@ void spline::add_point( vector2 new_pt )
 
 	m_lengths[m_num_points] = 0.0f;
 	m_points[m_num_points] = new_pt;
+	mark_arc_dirty(m_num_points);
 	m_num_points++;
 
 	//set up the first virtual point
@@ -160,6 +253,7 @@ void spline::set_point_tangent(int p_num, const vector2 &new_tan)
 	Assert_return(p_num >= 0 && p_num < m_num_points);
 	
 	m_tangents[p_num] = new_tan;
+	mark_arc_dirty(p_num);
 }
 
 void spline::set_point_color( int p_num, uint color )
@@ -174,6 +268,7 @@ void spline::set_point_pos(int pt_num, const vector2 &new_pos)
 	if(pt_num < m_num_points)
 	{
 		m_points[pt_num] = new_pos;
+		mark_arc_dirty(pt_num);
 	}
 
 	if((pt_num == 0 || pt_num == 1) && m_num_points >= 2)
@@ -230,6 +325,534 @@ void spline::get_point( vector2 &pt_out, float t_val ) const
 }
 
 
+// Sample the spline at count evenly spaced t values from t_start to t_end,
+// inclusive.  Gives the same points as calling get_point for each, but only
+// works out each segment's tangents and coefficients once.
+//
+void spline::evaluate_range( float t_start, float t_end, int count, vector2 *points_out ) const
+{
+	Assert_return(count > 0 && points_out);
+
+	if (m_num_points < 2) {
+		for (int i = 0; i < count && m_num_points == 1; i++) {
+			points_out[i] = m_points[0];
+		}
+		return;
+	}
+
+	float t_step = (count > 1) ? (t_end - t_start) / i2fl(count - 1) : 0.0f;
+	float scale = i2fl(m_num_points - 1);
+
+	hermite_cubic cubic;
+	int cubic_seg = -1;
+
+	float u_vals[SPLINE_EVAL_BATCH];
+	int batch_start = 0;
+	int batch_count = 0;
+
+	for (int i = 0; i < count; i++) {
+		float t_val = t_start + (t_step * i2fl(i));
+		CAP(t_val, 0.0f, 1.0f);
+
+		float expanded_t_val = t_val * scale;
+		int seg = (int)fl_floor(expanded_t_val);
+		float u = expanded_t_val - i2fl(seg);
+
+		// flush what's buffered when it can't be evaluated with this sample.
+		if (batch_count > 0 && (seg != cubic_seg || batch_count == SPLINE_EVAL_BATCH)) {
+			hermite_cubic_evaluate(cubic, u_vals, batch_count, points_out + batch_start);
+			batch_count = 0;
+		}
+
+		if (seg >= m_num_points - 1) {
+			points_out[i] = m_points[m_num_points - 1];
+			continue;
+		}
+
+		if (seg != cubic_seg) {
+			vector2 slope1, slope2;
+			spline_get_tangent(slope1, seg);
+			spline_get_tangent(slope2, seg+1);
+			hermite_cubic_init(cubic, m_points[seg], m_points[seg+1], slope1, slope2);
+			cubic_seg = seg;
+		}
+
+		if (batch_count == 0) {
+			batch_start = i;
+		}
+		u_vals[batch_count++] = u;
+	}
+
+	if (batch_count > 0) {
+		hermite_cubic_evaluate(cubic, u_vals, batch_count, points_out + batch_start);
+	}
+}
+
+// Closest point on a cubic to pt, by newton's method on the derivative of the
+// squared distance, starting from u.
+//
+// returns: the u found, with the squared distance there in dist_sq_out.
+//
+static float hermite_cubic_closest(const hermite_cubic &cubic, const vector2 &pt, float u, float &dist_sq_out)
+{
+	for (int i = 0; i < 8; i++) {
+		vector2 pos = (((cubic.a * u) + cubic.b) * u + cubic.c) * u + cubic.d;
+		vector2 deriv = ((cubic.a * (3.0f * u)) + (cubic.b * 2.0f)) * u + cubic.c;
+		vector2 deriv2 = (cubic.a * (6.0f * u)) + (cubic.b * 2.0f);
+		vector2 diff = pos - pt;
+
+		// curving away, so a newton step would head for a maximum.
+		float slope = deriv.dot(deriv) + diff.dot(deriv2);
+		if (slope <= 0.0f) {
+			break;
+		}
+
+		float new_u = u - (diff.dot(deriv) / slope);
+		CAP(new_u, 0.0f, 1.0f);
+		bool done = fl_abs(new_u - u) < 1e-6f;
+		u = new_u;
+		if (done) {
+			break;
+		}
+	}
+
+	vector2 pos = (((cubic.a * u) + cubic.b) * u + cubic.c) * u + cubic.d;
+	dist_sq_out = pos.dist_squared(pt);
+	return u;
+}
+
+// Closest point on a whole segment.  Newton alone can settle on the wrong bend,
+// so start it from the best of a few samples.
+//
+static float hermite_cubic_closest_sampled(const hermite_cubic &cubic, const vector2 &pt, float &dist_sq_out)
+{
+	float best_u = 0.0f;
+	float best_dist_sq = FLT_MAX;
+	for (int i = 0; i <= SPLINE_PROJECT_SAMPLES; i++) {
+		float u = i2fl(i) / SPLINE_PROJECT_SAMPLES;
+		vector2 pos = (((cubic.a * u) + cubic.b) * u + cubic.c) * u + cubic.d;
+		float dist_sq = pos.dist_squared(pt);
+		if (dist_sq < best_dist_sq) {
+			best_dist_sq = dist_sq;
+			best_u = u;
+		}
+	}
+
+	float u = hermite_cubic_closest(cubic, pt, best_u, dist_sq_out);
+	if (dist_sq_out > best_dist_sq) {
+		dist_sq_out = best_dist_sq;
+		u = best_u;
+	}
+	return u;
+}
+
+// returns: the square of the distance from a point to a box, 0 inside it.
+//
+static float dist_squared_to_box(const vector2 &pt, const vector2 &box_min, const vector2 &box_max)
+{
+	float dx = MAX(MAX(box_min.x - pt.x, pt.x - box_max.x), 0.0f);
+	float dy = MAX(MAX(box_min.y - pt.y, pt.y - box_max.y), 0.0f);
+	return SQUARED(dx) + SQUARED(dy);
+}
+
+// Fill in the results of a projection.
+//
+static void spline_project_result(const hermite_cubic &cubic, int seg, float u, float dist_sq, int num_points,
+	float *t_out, float *dist_out, vector2 *closest_out)
+{
+	if (t_out) {
+		*t_out = (i2fl(seg) + u) / i2fl(num_points - 1);
+	}
+	if (dist_out) {
+		*dist_out = sqrtf(dist_sq);
+	}
+	if (closest_out) {
+		*closest_out = (((cubic.a * u) + cubic.b) * u + cubic.c) * u + cubic.d;
+	}
+}
+
+// Find the closest point on the curve to pt.  Segments whose boxes are further
+// away than the best found so far are skipped, starting from the nearest box,
+// so usually only a segment or two are searched.
+//
+// t_out gets the t_val of the closest point, and dist_out and closest_out, if
+// given, the distance to it and where it is.
+//
+void spline::project( const vector2 &pt, float *t_out, float *dist_out /* = NULL */, vector2 *closest_out /* = NULL */ ) const
+{
+	Assert_return(m_num_points > 0);
+
+	if (m_num_points < 2) {
+		if (t_out) {
+			*t_out = 0.0f;
+		}
+		if (dist_out) {
+			*dist_out = pt.dist(m_points[0]);
+		}
+		if (closest_out) {
+			*closest_out = m_points[0];
+		}
+		return;
+	}
+
+	update_arc_table();
+	int num_segs = m_num_points - 1;
+
+	int nearest_seg = 0;
+	float nearest_box_dist_sq = FLT_MAX;
+	for (int seg = 0; seg < num_segs; seg++) {
+		float box_dist_sq = dist_squared_to_box(pt, m_seg_min[seg], m_seg_max[seg]);
+		if (box_dist_sq < nearest_box_dist_sq) {
+			nearest_box_dist_sq = box_dist_sq;
+			nearest_seg = seg;
+		}
+	}
+
+	hermite_cubic cubic, best_cubic;
+	vector2 slope1, slope2;
+	spline_get_tangent(slope1, nearest_seg);
+	spline_get_tangent(slope2, nearest_seg+1);
+	hermite_cubic_init(best_cubic, m_points[nearest_seg], m_points[nearest_seg+1], slope1, slope2);
+
+	float best_dist_sq;
+	float best_u = hermite_cubic_closest_sampled(best_cubic, pt, best_dist_sq);
+	int best_seg = nearest_seg;
+
+	for (int seg = 0; seg < num_segs; seg++) {
+		if (seg == nearest_seg || dist_squared_to_box(pt, m_seg_min[seg], m_seg_max[seg]) >= best_dist_sq) {
+			continue;
+		}
+
+		spline_get_tangent(slope1, seg);
+		spline_get_tangent(slope2, seg+1);
+		hermite_cubic_init(cubic, m_points[seg], m_points[seg+1], slope1, slope2);
+
+		float dist_sq;
+		float u = hermite_cubic_closest_sampled(cubic, pt, dist_sq);
+		if (dist_sq < best_dist_sq) {
+			best_dist_sq = dist_sq;
+			best_u = u;
+			best_seg = seg;
+			best_cubic = cubic;
+		}
+	}
+
+	spline_project_result(best_cubic, best_seg, best_u, best_dist_sq, m_num_points, t_out, dist_out, closest_out);
+}
+
+// Find the closest point on the curve to pt near t_guess, stepping onto
+// neighboring segments while that keeps getting closer.  This is a local
+// search: when pt jumps to another part of the curve, use project() instead.
+//
+void spline::project_from( const vector2 &pt, float t_guess, float *t_out, float *dist_out /* = NULL */, vector2 *closest_out /* = NULL */ ) const
+{
+	if (m_num_points < 2) {
+		project(pt, t_out, dist_out, closest_out);
+		return;
+	}
+
+	CAP(t_guess, 0.0f, 1.0f);
+	float expanded_t_val = t_guess * i2fl(m_num_points - 1);
+	int seg = (int)fl_floor(expanded_t_val);
+	float u = expanded_t_val - i2fl(seg);
+	if (seg >= m_num_points - 1) {
+		seg = m_num_points - 2;
+		u = 1.0f;
+	}
+
+	hermite_cubic cubic;
+	vector2 slope1, slope2;
+	spline_get_tangent(slope1, seg);
+	spline_get_tangent(slope2, seg+1);
+	hermite_cubic_init(cubic, m_points[seg], m_points[seg+1], slope1, slope2);
+
+	// newton can stall where the curve bends tighter than pt is far from it,
+	// so check the guess against a search of the whole segment.
+	float dist_sq, sampled_dist_sq;
+	u = hermite_cubic_closest(cubic, pt, u, dist_sq);
+	float sampled_u = hermite_cubic_closest_sampled(cubic, pt, sampled_dist_sq);
+	if (sampled_dist_sq < dist_sq) {
+		u = sampled_u;
+		dist_sq = sampled_dist_sq;
+	}
+
+	for (int hop = 0; hop < SPLINE_PROJECT_MAX_HOPS; hop++) {
+		int next_seg;
+		float next_u;
+		if (u <= 0.0f && seg > 0) {
+			next_seg = seg - 1;
+			next_u = 1.0f;
+		} else if (u >= 1.0f && seg < m_num_points - 2) {
+			next_seg = seg + 1;
+			next_u = 0.0f;
+		} else {
+			break;
+		}
+
+		hermite_cubic next_cubic;
+		spline_get_tangent(slope1, next_seg);
+		spline_get_tangent(slope2, next_seg+1);
+		hermite_cubic_init(next_cubic, m_points[next_seg], m_points[next_seg+1], slope1, slope2);
+
+		float next_dist_sq;
+		next_u = hermite_cubic_closest(next_cubic, pt, next_u, next_dist_sq);
+		if (next_dist_sq >= dist_sq) {
+			break;
+		}
+
+		seg = next_seg;
+		u = next_u;
+		dist_sq = next_dist_sq;
+		cubic = next_cubic;
+	}
+
+	spline_project_result(cubic, seg, u, dist_sq, m_num_points, t_out, dist_out, closest_out);
+}
+
+// A piece of a hermite segment as bezier control points, waiting to be checked.
+struct tessellate_piece {
+	vector2 ctrl[4];
+	float u_start, u_end;
+	int depth;
+};
+
+// returns: the square of the distance from a point to the segment between a and b.
+//
+static float dist_squared_to_segment(const vector2 &pt, const vector2 &a, const vector2 &b)
+{
+	vector2 ab = b - a;
+	float len_sq = ab.mag_squared();
+	if (len_sq <= 0.0f) {
+		return pt.dist_squared(a);
+	}
+
+	float frac = (pt - a).dot(ab) / len_sq;
+	CAP(frac, 0.0f, 1.0f);
+	return pt.dist_squared(a + (ab * frac));
+}
+
+// Split a hermite segment into pieces that stay within tolerance of a straight
+// line, and write the end of each piece.  The start of the segment is left to
+// the caller.
+//
+// Each point on a bezier is a weighted average of the control points, and the
+// inner two never get more than 3/4 of the weight between them, so a piece
+// strays at most 3/4 as far from its chord as they do.
+//
+// u_offset and u_scale map the segment's own u to the one reported in u_out.
+//
+// returns: false if points_out filled up first.
+//
+static bool tessellate_segment(const vector2 &pk1, const vector2 &pk2, const vector2 &slope1, const vector2 &slope2, float tolerance_sq,
+	float u_offset, float u_scale, vector2 *points_out, float *u_out, int &num_points, int max_points)
+{
+	float ctrl_tolerance_sq = tolerance_sq * (16.0f / 9.0f);
+
+	tessellate_piece stack[SPLINE_TESSELLATE_MAX_DEPTH + 1];
+	int stack_size = 1;
+
+	tessellate_piece &first = stack[0];
+	first.ctrl[0] = pk1;
+	first.ctrl[1] = pk1 + (slope1 / 3.0f);
+	first.ctrl[2] = pk2 - (slope2 / 3.0f);
+	first.ctrl[3] = pk2;
+	first.u_start = 0.0f;
+	first.u_end = 1.0f;
+	first.depth = 0;
+
+	while (stack_size > 0) {
+		tessellate_piece piece = stack[--stack_size];
+		const vector2 *ctrl = piece.ctrl;
+
+		bool flat = dist_squared_to_segment(ctrl[1], ctrl[0], ctrl[3]) <= ctrl_tolerance_sq &&
+			dist_squared_to_segment(ctrl[2], ctrl[0], ctrl[3]) <= ctrl_tolerance_sq;
+
+		if (flat || piece.depth >= SPLINE_TESSELLATE_MAX_DEPTH) {
+			Assert_return_value(num_points < max_points, false);
+			points_out[num_points] = ctrl[3];
+			if (u_out) {
+				u_out[num_points] = u_offset + (piece.u_end * u_scale);
+			}
+			num_points++;
+			continue;
+		}
+
+		// de casteljau at the middle.  the second half goes on the stack first,
+		// so the first half comes off next and the points stay in order.
+		vector2 ab = (ctrl[0] + ctrl[1]) * 0.5f;
+		vector2 bc = (ctrl[1] + ctrl[2]) * 0.5f;
+		vector2 cd = (ctrl[2] + ctrl[3]) * 0.5f;
+		vector2 abc = (ab + bc) * 0.5f;
+		vector2 bcd = (bc + cd) * 0.5f;
+		vector2 mid = (abc + bcd) * 0.5f;
+		float u_mid = (piece.u_start + piece.u_end) * 0.5f;
+
+		tessellate_piece &second = stack[stack_size++];
+		second.ctrl[0] = mid;
+		second.ctrl[1] = bcd;
+		second.ctrl[2] = cd;
+		second.ctrl[3] = ctrl[3];
+		second.u_start = u_mid;
+		second.u_end = piece.u_end;
+		second.depth = piece.depth + 1;
+
+		tessellate_piece &half = stack[stack_size++];
+		half.ctrl[0] = piece.ctrl[0];
+		half.ctrl[1] = ab;
+		half.ctrl[2] = abc;
+		half.ctrl[3] = mid;
+		half.u_start = piece.u_start;
+		half.u_end = u_mid;
+		half.depth = piece.depth + 1;
+	}
+
+	return true;
+}
+
+// Turn the spline into a polyline that strays no further than tolerance from
+// the curve, with more points where it bends and fewer where it's straight.
+// For an error bound in pixels, pass the pixel tolerance divided by the pixels
+// per unit.
+//
+// t_out, if given, gets the t_val of each point, ie. for get_color.
+//
+// returns: the number of points written.  Asserts if max_points isn't enough,
+// returning the points up to there.
+//
+int spline::tessellate( float tolerance, vector2 *points_out, int max_points, float *t_out /* = NULL */ ) const
+{
+	Assert_return_value(points_out && max_points > 0 && m_num_points > 0, 0);
+	Assert(tolerance > 0.0f);
+
+	points_out[0] = m_points[0];
+	if (t_out) {
+		t_out[0] = 0.0f;
+	}
+	int num_points = 1;
+
+	float tolerance_sq = SQUARED(tolerance);
+	float t_scale = (m_num_points > 1) ? 1.0f / i2fl(m_num_points - 1) : 0.0f;
+	for (int seg = 0; seg < m_num_points - 1; seg++) {
+		vector2 slope1, slope2;
+		spline_get_tangent(slope1, seg);
+		spline_get_tangent(slope2, seg+1);
+
+		if (!tessellate_segment(m_points[seg], m_points[seg+1], slope1, slope2, tolerance_sq, i2fl(seg) * t_scale, t_scale,
+			points_out, t_out, num_points, max_points)) {
+			break;
+		}
+	}
+
+	return num_points;
+}
+
+// A color pulled apart once, so blending it along a ribbon gives the same
+// results as color_lerp without unpacking both ends every time.
+struct ribbon_color_lerp {
+	int r1, g1, b1, a1;
+	int r2, g2, b2, a2;
+
+	void init(uint from_color, uint to_color) {
+		r1 = COLOR_GET_RED(from_color);
+		g1 = COLOR_GET_GREEN(from_color);
+		b1 = COLOR_GET_BLUE(from_color);
+		a1 = COLOR_GET_ALPHA(from_color);
+		r2 = COLOR_GET_RED(to_color);
+		g2 = COLOR_GET_GREEN(to_color);
+		b2 = COLOR_GET_BLUE(to_color);
+		a2 = COLOR_GET_ALPHA(to_color);
+	}
+
+	uint get(float amt) const {
+		int r = fl2i(LERP(r1, r2, amt));
+		int g = fl2i(LERP(g1, g2, amt));
+		int b = fl2i(LERP(b1, b2, amt));
+		int a = fl2i(LERP(a1, a2, amt));
+		return COLOR(r, g, b, a);
+	}
+};
+
+// The hermite blending functions at u, for the two points and two tangents.
+//
+static inline void hermite_basis(float u, float &h_pk1, float &h_pk2, float &h_slope1, float &h_slope2)
+{
+	float u2 = SQUARED(u);
+	float u3 = u * u2;
+
+	h_pk1 = 2*u3 - 3*u2 + 1;
+	h_pk2 = -2*u3 + 3*u2;
+	h_slope1 = u3 - 2*u2 + u;
+	h_slope2 = u3 - u2;
+}
+
+// Build a triangle strip count samples long, from t_start to t_end, with
+// edges half_width to either side.  Writes count * 2 vertices, left then right
+// at each sample.  v is the t_val.
+//
+// The edges are where get_point_offset puts them.  Offsetting both ends of a
+// segment moves the curve by a blend of the two end normals, so the center and
+// that blend are worked out once and shared by both edges.
+//
+void spline::make_ribbon( float t_start, float t_end, int count, float half_width, ribbon_vertex *verts_out ) const
+{
+	Assert_return(count > 0 && verts_out && m_num_points >= 2);
+
+	float t_step = (count > 1) ? (t_end - t_start) / i2fl(count - 1) : 0.0f;
+	float scale = i2fl(m_num_points - 1);
+
+	int cur_seg = -1;
+	vector2 pk1, pk2, slope1, slope2, normal1, normal2;
+	ribbon_color_lerp color;
+	color.init(0xFFFFFFFF, 0xFFFFFFFF);
+
+	for (int i = 0; i < count; i++) {
+		float t_val = t_start + (t_step * i2fl(i));
+		CAP(t_val, 0.0f, 1.0f);
+
+		float expanded_t_val = t_val * scale;
+		int seg = (int)fl_floor(expanded_t_val);
+		float u = expanded_t_val - i2fl(seg);
+
+		// the very end is the end of the last segment.
+		if (seg >= m_num_points - 1) {
+			seg = m_num_points - 2;
+			u = 1.0f;
+		}
+
+		if (seg != cur_seg) {
+			pk1 = m_points[seg];
+			pk2 = m_points[seg+1];
+			spline_get_tangent(slope1, seg);
+			spline_get_tangent(slope2, seg+1);
+			normal1 = slope1.rvec().copy_normalize();
+			normal2 = slope2.rvec().copy_normalize();
+			if (m_colors) {
+				color.init(m_colors[seg], m_colors[seg+1]);
+			}
+			cur_seg = seg;
+		}
+
+		float h_pk1, h_pk2, h_slope1, h_slope2;
+		hermite_basis(u, h_pk1, h_pk2, h_slope1, h_slope2);
+
+		vector2 center = (pk1 * h_pk1) + (pk2 * h_pk2) + (slope1 * h_slope1) + (slope2 * h_slope2);
+		vector2 offset = ((normal1 * h_pk1) + (normal2 * h_pk2)) * half_width;
+		uint vert_color = color.get(u);
+
+		ribbon_vertex &left = verts_out[i * 2];
+		left.pos = center - offset;
+		left.u = 0.0f;
+		left.v = t_val;
+		left.color = vert_color;
+
+		ribbon_vertex &right = verts_out[(i * 2) + 1];
+		right.pos = center + offset;
+		right.u = 1.0f;
+		right.v = t_val;
+		right.color = vert_color;
+	}
+}
+
 void spline::get_point_offset( vector2 &pt_out, float t_val, float offset ) const
 {
 	CAP(t_val, 0, 1.0f);
@@ -286,6 +909,213 @@ int spline::get_max_points() const
 	return m_max_points;
 }
 
+// Flag the segments whose shape depends on a point.  Its tangent, and those of
+// its neighbors, feed into the two segments on either side.
+//
+void spline::mark_arc_dirty( int pt_index )
+{
+	int first = MAX(pt_index - 2, 0);
+	int last = MIN(pt_index + 1, m_max_points - 1);
+	for (int i = first; i <= last; i++) {
+		m_arc_dirty[i] = true;
+	}
+	m_arc_any_dirty = true;
+}
+
+// Five point Gauss-Legendre quadrature, nodes and weights on [-1, 1].
+static const float Gauss_nodes[5] = {0.0f, -0.5384693101f, 0.5384693101f, -0.9061798459f, 0.9061798459f};
+static const float Gauss_weights[5] = {0.5688888889f, 0.4786286705f, 0.4786286705f, 0.2369268851f, 0.2369268851f};
+
+// returns: how fast a point moves along a segment at u, ie. the length of the
+// derivative of the hermite curve.
+//
+static float hermite_speed(const vector2 &pk1, const vector2 &pk2, const vector2 &slope1, const vector2 &slope2, float u)
+{
+	float u2 = SQUARED(u);
+
+	float dh1 = 6*u2 - 6*u;
+	float dh2 = -6*u2 + 6*u;
+	float dt1 = 3*u2 - 4*u + 1;
+	float dt2 = 3*u2 - 2*u;
+
+	vector2 deriv = (pk1 * dh1) + (pk2 * dh2) + (slope1 * dt1) + (slope2 * dt2);
+	return deriv.mag();
+}
+
+// Resample any segments that changed, then redo the running distances, which
+// is just an add per segment.
+//
+void spline::update_arc_table() const
+{
+	if (!m_arc_any_dirty) {
+		return;
+	}
+
+	int num_segs = MAX(m_num_points - 1, 0);
+	float seg_start = 0.0f;
+	for (int seg = 0; seg < num_segs; seg++) {
+		float *steps = &m_arc_lengths[seg * SPLINE_ARC_STEPS];
+
+		if (m_arc_dirty[seg]) {
+			vector2 pk1 = m_points[seg];
+			vector2 pk2 = m_points[seg+1];
+			vector2 slope1, slope2;
+			spline_get_tangent(slope1, seg);
+			spline_get_tangent(slope2, seg+1);
+
+			float length = 0.0f;
+			float half_step = 0.5f / SPLINE_ARC_STEPS;
+			for (int i = 0; i < SPLINE_ARC_STEPS; i++) {
+				float mid = (i2fl(i) + 0.5f) / SPLINE_ARC_STEPS;
+				float step_length = 0.0f;
+				for (int j = 0; j < 5; j++) {
+					step_length += Gauss_weights[j] * hermite_speed(pk1, pk2, slope1, slope2, mid + (Gauss_nodes[j] * half_step));
+				}
+				length += step_length * half_step;
+				steps[i] = length;
+			}
+
+			// the curve stays inside its bezier control points.
+			vector2 ctrl1 = pk1 + (slope1 / 3.0f);
+			vector2 ctrl2 = pk2 - (slope2 / 3.0f);
+			m_seg_min[seg].x = MIN(MIN(pk1.x, pk2.x), MIN(ctrl1.x, ctrl2.x));
+			m_seg_min[seg].y = MIN(MIN(pk1.y, pk2.y), MIN(ctrl1.y, ctrl2.y));
+			m_seg_max[seg].x = MAX(MAX(pk1.x, pk2.x), MAX(ctrl1.x, ctrl2.x));
+			m_seg_max[seg].y = MAX(MAX(pk1.y, pk2.y), MAX(ctrl1.y, ctrl2.y));
+
+			m_arc_dirty[seg] = false;
+		}
+
+		m_arc_seg_start[seg] = seg_start;
+		seg_start += steps[SPLINE_ARC_STEPS - 1];
+	}
+	m_arc_seg_start[num_segs] = seg_start;
+
+	m_arc_any_dirty = false;
+}
+
+// Find where along the spline a distance from the start lands, as a segment
+// and the u within it.
+//
+void spline::find_distance( float dist, int &seg_out, float &u_out ) const
+{
+	update_arc_table();
+
+	int num_segs = m_num_points - 1;
+	if (dist <= 0.0f) {
+		seg_out = 0;
+		u_out = 0.0f;
+		return;
+	}
+	if (dist >= m_arc_seg_start[num_segs]) {
+		seg_out = num_segs - 1;
+		u_out = 1.0f;
+		return;
+	}
+
+	// the last segment starting at or before dist.
+	int lo = 0;
+	int hi = num_segs - 1;
+	while (lo < hi) {
+		int mid = (lo + hi + 1) / 2;
+		if (m_arc_seg_start[mid] <= dist) {
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	seg_out = lo;
+
+	// then the first step ending at or after it.
+	float local_dist = dist - m_arc_seg_start[lo];
+	const float *steps = &m_arc_lengths[lo * SPLINE_ARC_STEPS];
+	lo = 0;
+	hi = SPLINE_ARC_STEPS - 1;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (steps[mid] < local_dist) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	float step_start = (lo > 0) ? steps[lo-1] : 0.0f;
+	float step_length = steps[lo] - step_start;
+	float frac = (step_length > 0.0f) ? (local_dist - step_start) / step_length : 0.0f;
+	CAP(frac, 0.0f, 1.0f);
+
+	// interpolating within the step assumes even speed across it, so take a
+	// newton step on the real length to the guess.
+	float step_u = i2fl(lo) / SPLINE_ARC_STEPS;
+	float u = step_u + (frac / SPLINE_ARC_STEPS);
+
+	vector2 pk1 = m_points[seg_out];
+	vector2 pk2 = m_points[seg_out+1];
+	vector2 slope1, slope2;
+	spline_get_tangent(slope1, seg_out);
+	spline_get_tangent(slope2, seg_out+1);
+
+	float half_width = (u - step_u) * 0.5f;
+	float mid = step_u + half_width;
+	float guess_dist = step_start;
+	for (int j = 0; j < 5; j++) {
+		guess_dist += Gauss_weights[j] * hermite_speed(pk1, pk2, slope1, slope2, mid + (Gauss_nodes[j] * half_width)) * half_width;
+	}
+
+	float speed = hermite_speed(pk1, pk2, slope1, slope2, u);
+	if (speed > 0.0f) {
+		u -= (guess_dist - local_dist) / speed;
+	}
+	CAP(u, step_u, step_u + (1.0f / SPLINE_ARC_STEPS));
+	u_out = u;
+}
+
+// Length along the curve itself, unlike get_approximate_length, which only adds
+// up the distances between points.
+//
+float spline::get_arc_length() const
+{
+	if (m_num_points < 2) {
+		return 0.0f;
+	}
+
+	update_arc_table();
+	return m_arc_seg_start[m_num_points - 1];
+}
+
+// returns: the t_val, as taken by get_point, at a distance along the curve.
+//
+float spline::get_t_at_distance( float dist ) const
+{
+	if (m_num_points < 2) {
+		return 0.0f;
+	}
+
+	int seg;
+	float u;
+	find_distance(dist, seg, u);
+	return (i2fl(seg) + u) / i2fl(m_num_points - 1);
+}
+
+// Get the point a distance along the curve from the start.  Stepping the
+// distance evenly moves the point at an even speed, which stepping t doesn't.
+//
+void spline::get_point_at_distance( vector2 &pt_out, float dist ) const
+{
+	if (m_num_points < 2) {
+		if (m_num_points == 1) {
+			pt_out = m_points[0];
+		}
+		return;
+	}
+
+	int seg;
+	float u;
+	find_distance(dist, seg, u);
+	get_point(pt_out, seg, u);
+}
+
 uint spline::get_color( float t_val ) const
 {
 	if (m_colors == NULL) {
@@ -338,6 +1168,104 @@ void spline_simple::get_point( vector2 &pt_out, float u_val, float lat_offset /*
 	}
 }
 
+// Sample count evenly spaced u values from u_start to u_end, inclusive, the same
+// as get_point with no lateral offset.
+//
+void spline_simple::evaluate_range( float u_start, float u_end, int count, vector2 *points_out ) const
+{
+	Assert_return(count > 0 && points_out);
+
+	hermite_cubic cubic;
+	hermite_cubic_init(cubic, point1, point2, tan1, tan2);
+
+	float u_step = (count > 1) ? (u_end - u_start) / i2fl(count - 1) : 0.0f;
+	float u_vals[SPLINE_EVAL_BATCH];
+
+	for (int batch_start = 0; batch_start < count; batch_start += SPLINE_EVAL_BATCH) {
+		int batch_count = MIN(count - batch_start, SPLINE_EVAL_BATCH);
+		for (int i = 0; i < batch_count; i++) {
+			float u = u_start + (u_step * i2fl(batch_start + i));
+			CAP(u, 0.0f, 1.0f);
+			u_vals[i] = u;
+		}
+
+		hermite_cubic_evaluate(cubic, u_vals, batch_count, points_out + batch_start);
+
+		// the ends come out exact in get_point.
+		for (int i = 0; i < batch_count; i++) {
+			if (u_vals[i] == 1.0f) {
+				points_out[batch_start + i] = point2;
+			}
+		}
+	}
+}
+
+// Turn the curve into a polyline that strays no further than tolerance from it.
+// See spline::tessellate.
+//
+// returns: the number of points written.
+//
+int spline_simple::tessellate( float tolerance, vector2 *points_out, int max_points, float *u_out /* = NULL */ ) const
+{
+	Assert_return_value(points_out && max_points > 0, 0);
+	Assert(tolerance > 0.0f);
+
+	points_out[0] = point1;
+	if (u_out) {
+		u_out[0] = 0.0f;
+	}
+	int num_points = 1;
+
+	tessellate_segment(point1, point2, tan1, tan2, SQUARED(tolerance), 0.0f, 1.0f, points_out, u_out, num_points, max_points);
+	return num_points;
+}
+
+// Build a triangle strip count samples long, from u_start to u_end, with
+// edges half_width to either side, scaled along the way by width1 and width2.
+// Writes count * 2 vertices, left then right at each sample.  v is the u_val.
+//
+// The edges are where get_point puts them with a lateral offset, including the
+// balance on the left side, and the color is get_color's.
+//
+void spline_simple::make_ribbon( float u_start, float u_end, int count, float half_width, ribbon_vertex *verts_out ) const
+{
+	Assert_return(count > 0 && verts_out);
+
+	vector2 normal1 = tan1.rvec().copy_normalize();
+	vector2 normal2 = tan2.rvec().copy_normalize();
+
+	ribbon_color_lerp color;
+	color.init(color1, color2);
+
+	float u_step = (count > 1) ? (u_end - u_start) / i2fl(count - 1) : 0.0f;
+	for (int i = 0; i < count; i++) {
+		float u = u_start + (u_step * i2fl(i));
+		CAP(u, 0.0f, 1.0f);
+
+		float h_pk1, h_pk2, h_slope1, h_slope2;
+		hermite_basis(u, h_pk1, h_pk2, h_slope1, h_slope2);
+
+		vector2 center = (point1 * h_pk1) + (point2 * h_pk2) + (tan1 * h_slope1) + (tan2 * h_slope2);
+		vector2 offset = ((normal1 * h_pk1) + (normal2 * h_pk2)) * (half_width * LERP(width1, width2, u));
+
+		// the left side's tangents are scaled by the balance.
+		vector2 balance_shift = (tan1 * ((balance1 - 1.0f) * h_slope1)) + (tan2 * ((balance2 - 1.0f) * h_slope2));
+		uint vert_color = color.get(u);
+
+		ribbon_vertex &left = verts_out[i * 2];
+		left.pos = center - offset + balance_shift;
+		left.u = 0.0f;
+		left.v = u;
+		left.color = vert_color;
+
+		ribbon_vertex &right = verts_out[(i * 2) + 1];
+		right.pos = center + offset;
+		right.u = 1.0f;
+		right.v = u;
+		right.color = vert_color;
+	}
+}
+
 // VERY rough approximation of length.  Just the distance from one point to the next.
 //
 float spline_simple::get_approximate_length() const
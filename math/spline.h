@@ -5,6 +5,27 @@
 
 #include "vector.h"
 
+// Steps per segment in the arc length table.  Lookups interpolate linearly
+// between steps, so this trades memory for how evenly distance maps to points.
+#define SPLINE_ARC_STEPS		(16)
+
+// How many times tessellate() will halve a piece of a segment, at most.
+#define SPLINE_TESSELLATE_MAX_DEPTH		(16)
+
+// project() samples each segment it can't rule out this many times before
+// refining the closest sample, and project_from() steps across at most this
+// many segments from its starting guess.
+#define SPLINE_PROJECT_SAMPLES			(8)
+#define SPLINE_PROJECT_MAX_HOPS			(4)
+
+// A vertex of a ribbon along a spline.  u runs across the ribbon, 0 on the left
+// edge and 1 on the right, and v along it.
+struct ribbon_vertex {
+	vector2 pos;
+	float u, v;
+	uint color;
+};
+
 // a stupid-simple spline with just two points and tangents at each.
 //
 // Unlike the full spline, this can be allocated on the stack without
@@ -40,6 +61,9 @@ public:
 	void set_tangents(const vector2 &_tan1, const vector2 &_tan2);
 
 	void get_point(vector2 &pt_out, float u_val, float lat_offset = 0.0f) const;
+	void evaluate_range(float u_start, float u_end, int count, vector2 *points_out) const;
+	int tessellate(float tolerance, vector2 *points_out, int max_points, float *u_out = NULL) const;
+	void make_ribbon(float u_start, float u_end, int count, float half_width, ribbon_vertex *verts_out) const;
 	uint get_color(float u_val, float lerp_scalar = 1.0f) const;
 	float get_approximate_length() const;
 	void get_approximate_tangent( vector2 &tangent_out, float u_val );
@@ -60,6 +84,21 @@ class spline{
 
 		vector2 expanded_point_min, expanded_point_max;
 
+		// Arc length table, rebuilt on demand one segment at a time.  For each
+		// segment, the length from its start to the end of each step, the
+		// distance along the whole spline to where it starts, and a box around
+		// its control points.
+		mutable float *m_arc_lengths;
+		mutable float *m_arc_seg_start;
+		mutable vector2 *m_seg_min;
+		mutable vector2 *m_seg_max;
+		mutable bool *m_arc_dirty;
+		mutable bool m_arc_any_dirty;
+
+		void mark_arc_dirty(int pt_index);
+		void update_arc_table() const;
+		void find_distance(float dist, int &seg_out, float &u_out) const;
+
 		struct {
 			bool length_locked : 1;
 		} m_spline_flags;
@@ -80,6 +119,9 @@ class spline{
 		void get_point(vector2 &pt_out, int pt_index, float u_val, float lat_offset = 0.0f) const;
 		void get_point(vector2 &pt_out, float t_val) const;
 		void get_point_offset(vector2 &pt_out, float t_val, float offset) const;
+		void evaluate_range(float t_start, float t_end, int count, vector2 *points_out) const;
+		int tessellate(float tolerance, vector2 *points_out, int max_points, float *t_out = NULL) const;
+		void make_ribbon(float t_start, float t_end, int count, float half_width, ribbon_vertex *verts_out) const;
 		uint get_color(float t_val) const;
 
 		void set_point_pos(int p_num, const vector2 &new_pos);
@@ -92,6 +134,16 @@ class spline{
 		float get_approximate_length() const {return m_length;}
 		float get_approximate_segment_length(int seg_num) const;
 		void get_approximate_tangent(vector2 &tangent_out, float t_val) const;
+
+		// Exact (to within the table) distances along the curve.
+		float get_arc_length() const;
+		float get_t_at_distance(float dist) const;
+		void get_point_at_distance(vector2 &pt_out, float dist) const;
+
+		// Closest point on the curve.  project_from only searches near a guess,
+		// ie. last frame's t for something moving along the spline.
+		void project(const vector2 &pt, float *t_out, float *dist_out = NULL, vector2 *closest_out = NULL) const;
+		void project_from(const vector2 &pt, float t_guess, float *t_out, float *dist_out = NULL, vector2 *closest_out = NULL) const;
 };
 
 #endif //__SPLINE_H
\ No newline at end of file
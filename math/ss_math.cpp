@@ -1,5 +1,9 @@
 #include "ss_math.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 // lerps between start_radians and end_radians according to pct (0-1).
 // will output a value between 0 and 2pi.
 //
@@ -27,3 +31,140 @@ float lerp_radians( float start_radians, float end_radians, const float pct )
 	// Debug.Log("Start: "  + start + "   End: " + end + "  Value: " + value + "  Half: " + half + "  Diff: " + diff + "  Retval: " + retval);
 	return retval;
 }
+
+#if defined(__SSE2__)
+
+// Four lanes of fast_sincos, with the quadrant fixup done by masks instead of
+// a switch.  Bit 0 of the quadrant swaps sin and cos; bit 1 (of quadrant + 1,
+// for cos) flips the sign.
+//
+static inline void fast_sincos_4(__m128 radians, __m128 &sin_out, __m128 &cos_out)
+{
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 sign_mask = _mm_set1_ps(-0.0f);
+	const __m128i one = _mm_set1_epi32(1);
+	const __m128i two = _mm_set1_epi32(2);
+
+	// round half away from zero, the same as fast_trig_reduce.
+	__m128 scaled = _mm_mul_ps(radians, _mm_set1_ps(FAST_TRIG_2_OVER_PI));
+	__m128 bias = _mm_or_ps(half, _mm_and_ps(scaled, sign_mask));
+	__m128i quadrant = _mm_cvttps_epi32(_mm_add_ps(scaled, bias));
+	__m128 q = _mm_cvtepi32_ps(quadrant);
+	__m128 r = _mm_sub_ps(radians, _mm_mul_ps(q, _mm_set1_ps(FAST_TRIG_PIO2_A)));
+	r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(FAST_TRIG_PIO2_B)));
+	r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(FAST_TRIG_PIO2_C)));
+	__m128 z = _mm_mul_ps(r, r);
+
+	__m128 s = _mm_add_ps(_mm_set1_ps(FAST_SIN_C2), _mm_mul_ps(z, _mm_set1_ps(FAST_SIN_C3)));
+	s = _mm_add_ps(_mm_set1_ps(FAST_SIN_C1), _mm_mul_ps(z, s));
+	s = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, z), s));
+
+	__m128 c = _mm_add_ps(_mm_set1_ps(FAST_COS_C2), _mm_mul_ps(z, _mm_set1_ps(FAST_COS_C3)));
+	c = _mm_add_ps(_mm_set1_ps(FAST_COS_C1), _mm_mul_ps(z, c));
+	c = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(half, z)), _mm_mul_ps(_mm_mul_ps(z, z), c));
+
+	__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, one), one));
+	__m128 sin_val = _mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s));
+	__m128 cos_val = _mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c));
+
+	__m128 sin_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, two), 30));
+	__m128 cos_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, one), two), 30));
+	sin_out = _mm_xor_ps(sin_val, sin_sign);
+	cos_out = _mm_xor_ps(cos_val, cos_sign);
+}
+
+// Four lanes of fast_atan2.
+//
+static inline __m128 fast_atan2_4(__m128 y, __m128 x)
+{
+	const __m128 sign_mask = _mm_set1_ps(-0.0f);
+	const __m128 zero = _mm_setzero_ps();
+
+	__m128 abs_x = _mm_andnot_ps(sign_mask, x);
+	__m128 abs_y = _mm_andnot_ps(sign_mask, y);
+	__m128 max = _mm_max_ps(abs_x, abs_y);
+	__m128 min = _mm_min_ps(abs_x, abs_y);
+	__m128 valid = _mm_cmpneq_ps(max, zero);
+
+	// lanes at the origin divide by zero, and get masked off at the end.
+	__m128 a = _mm_div_ps(min, max);
+	__m128 z = _mm_mul_ps(a, a);
+	__m128 p = _mm_add_ps(_mm_set1_ps(FAST_ATAN_C7), _mm_mul_ps(z, _mm_set1_ps(FAST_ATAN_C8)));
+	p = _mm_add_ps(_mm_set1_ps(FAST_ATAN_C6), _mm_mul_ps(z, p));
+	p = _mm_add_ps(_mm_set1_ps(FAST_ATAN_C5), _mm_mul_ps(z, p));
+	p = _mm_add_ps(_mm_set1_ps(FAST_ATAN_C4), _mm_mul_ps(z, p));
+	p = _mm_add_ps(_mm_set1_ps(FAST_ATAN_C3), _mm_mul_ps(z, p));
+	p = _mm_add_ps(_mm_set1_ps(FAST_ATAN_C2), _mm_mul_ps(z, p));
+	p = _mm_add_ps(_mm_set1_ps(FAST_ATAN_C1), _mm_mul_ps(z, p));
+	p = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(z, p));
+	__m128 angle = _mm_mul_ps(a, p);
+
+	__m128 steep = _mm_cmpgt_ps(abs_y, abs_x);
+	angle = _mm_or_ps(_mm_and_ps(steep, _mm_sub_ps(_mm_set1_ps(FAST_TRIG_PI_OVER_2), angle)), _mm_andnot_ps(steep, angle));
+	__m128 behind = _mm_cmplt_ps(x, zero);
+	angle = _mm_or_ps(_mm_and_ps(behind, _mm_sub_ps(_mm_set1_ps(FAST_TRIG_PI), angle)), _mm_andnot_ps(behind, angle));
+	angle = _mm_xor_ps(angle, _mm_and_ps(_mm_cmplt_ps(y, zero), sign_mask));
+
+	return _mm_and_ps(angle, valid);
+}
+
+#endif
+
+void fast_sin_array(const float *radians, float *sin_out, int count)
+{
+	int i = 0;
+#if defined(__SSE2__)
+	for (; i + 4 <= count; i += 4) {
+		__m128 s, c;
+		fast_sincos_4(_mm_loadu_ps(radians + i), s, c);
+		_mm_storeu_ps(sin_out + i, s);
+	}
+#endif
+	for (; i < count; i++) {
+		sin_out[i] = fast_sin(radians[i]);
+	}
+}
+
+void fast_cos_array(const float *radians, float *cos_out, int count)
+{
+	int i = 0;
+#if defined(__SSE2__)
+	for (; i + 4 <= count; i += 4) {
+		__m128 s, c;
+		fast_sincos_4(_mm_loadu_ps(radians + i), s, c);
+		_mm_storeu_ps(cos_out + i, c);
+	}
+#endif
+	for (; i < count; i++) {
+		cos_out[i] = fast_cos(radians[i]);
+	}
+}
+
+void fast_sincos_array(const float *radians, float *sin_out, float *cos_out, int count)
+{
+	int i = 0;
+#if defined(__SSE2__)
+	for (; i + 4 <= count; i += 4) {
+		__m128 s, c;
+		fast_sincos_4(_mm_loadu_ps(radians + i), s, c);
+		_mm_storeu_ps(sin_out + i, s);
+		_mm_storeu_ps(cos_out + i, c);
+	}
+#endif
+	for (; i < count; i++) {
+		fast_sincos(radians[i], sin_out[i], cos_out[i]);
+	}
+}
+
+void fast_atan2_array(const float *y, const float *x, float *radians_out, int count)
+{
+	int i = 0;
+#if defined(__SSE2__)
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(radians_out + i, fast_atan2_4(_mm_loadu_ps(y + i), _mm_loadu_ps(x + i)));
+	}
+#endif
+	for (; i < count; i++) {
+		radians_out[i] = fast_atan2(y[i], x[i]);
+	}
+}
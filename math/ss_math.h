@@ -25,9 +25,23 @@ do {												\
 #define fl_sign(n) ((n < 0.f) ? -1.0f : 1.0f)
 #define fl_cap(a,min,max) (a > max ? max : (a < min ? min : a))
 
-// trig
+// trig.  Define SS_FAST_TRIG to route sin, cos and atan2 through the polynomial
+// approximations below.
+#ifdef SS_FAST_TRIG
+#define fl_cos(n)	fast_cos(n)
+#define fl_sin(n)	fast_sin(n)
+#define fl_sincos(n,s,c)	fast_sincos(n, s, c)
+#define fl_atan2(y,x)	fast_atan2(y, x)
+#else
 #define fl_cos(n)	cos(n)
 #define fl_sin(n)	sin(n)
+#define fl_sincos(n,s,c)	\
+do {						\
+	s = sinf(n);			\
+	c = cosf(n);			\
+} while (0)
+#define fl_atan2(y,x)	atan2(y, x)
+#endif
 #define fl_tan(n)	tan(n)
 #define fl_acos(n)	acos(n)
 #define fl_asin(n)	asin(n)
@@ -76,4 +90,128 @@ inline float clamp_radians_pos_neg(float radians)
 
 float lerp_radians(float start_radians, float end_radians, const float pct);
 
-#endif // __SS_MATH_H
\ No newline at end of file
+// Fast sin, cos and atan2.
+//
+// sin and cos reduce the angle to [-pi/4, pi/4] around the nearest multiple of
+// pi/2, then use minimax polynomials.  The max error is 1e-7 for angles within
+// +/-10000 radians, and 1e-6 out to +/-100000.  Past that the reduction falls
+// apart, so keep angles clamped.
+//
+// atan2 uses a polynomial for atan on [0, 1], folding the other octants onto
+// it.  The max error is 3e-7 radians.  Like atan2, it returns 0 for (0, 0).
+//
+// The array versions in ss_math.cpp give the same results as these, four at a
+// time when the compiler targets SSE2.
+//
+
+#define FAST_TRIG_PI			(3.14159265f)
+#define FAST_TRIG_PI_OVER_2		(1.57079633f)
+#define FAST_TRIG_2_OVER_PI		(0.636619772f)
+
+// pi/2 split in three, the first two short enough that multiplying them by the
+// quadrant count is exact.
+#define FAST_TRIG_PIO2_A		(1.5703125f)
+#define FAST_TRIG_PIO2_B		(4.837512969970703125e-4f)
+#define FAST_TRIG_PIO2_C		(7.54978995489188216e-8f)
+
+#define FAST_SIN_C1		(-1.6666654611e-1f)
+#define FAST_SIN_C2		(8.3321608736e-3f)
+#define FAST_SIN_C3		(-1.9515295891e-4f)
+#define FAST_COS_C1		(4.166664568298827e-2f)
+#define FAST_COS_C2		(-1.388731625493765e-3f)
+#define FAST_COS_C3		(2.443315711809948e-5f)
+
+#define FAST_ATAN_C1	(-0.3333314528f)
+#define FAST_ATAN_C2	(0.1999355085f)
+#define FAST_ATAN_C3	(-0.1420889944f)
+#define FAST_ATAN_C4	(0.1065626393f)
+#define FAST_ATAN_C5	(-0.0752896400f)
+#define FAST_ATAN_C6	(0.0429096138f)
+#define FAST_ATAN_C7	(-0.0161657367f)
+#define FAST_ATAN_C8	(0.0028662257f)
+
+// Split an angle into a quarter turn count and what's left over, in [-pi/4, pi/4].
+//
+inline int fast_trig_reduce(float radians, float &remainder_out)
+{
+	float scaled = radians * FAST_TRIG_2_OVER_PI;
+	int quadrant = (int)(scaled + ((scaled >= 0.0f) ? 0.5f : -0.5f));
+	float q = (float)quadrant;
+	remainder_out = ((radians - (q * FAST_TRIG_PIO2_A)) - (q * FAST_TRIG_PIO2_B)) - (q * FAST_TRIG_PIO2_C);
+	return quadrant;
+}
+
+inline float fast_sin_reduced(float r)
+{
+	float z = r * r;
+	return r + (r * z * (FAST_SIN_C1 + (z * (FAST_SIN_C2 + (z * FAST_SIN_C3)))));
+}
+
+inline float fast_cos_reduced(float r)
+{
+	float z = r * r;
+	return (1.0f - (0.5f * z)) + (z * z * (FAST_COS_C1 + (z * (FAST_COS_C2 + (z * FAST_COS_C3)))));
+}
+
+inline void fast_sincos(float radians, float &sin_out, float &cos_out)
+{
+	float r;
+	int quadrant = fast_trig_reduce(radians, r);
+	float s = fast_sin_reduced(r);
+	float c = fast_cos_reduced(r);
+
+	// odd quadrants swap sin and cos, and the signs follow the quadrant.
+	float sin_val = (quadrant & 1) ? c : s;
+	float cos_val = (quadrant & 1) ? s : c;
+	sin_out = (quadrant & 2) ? -sin_val : sin_val;
+	cos_out = ((quadrant + 1) & 2) ? -cos_val : cos_val;
+}
+
+inline float fast_sin(float radians)
+{
+	float r;
+	int quadrant = fast_trig_reduce(radians, r);
+	float val = (quadrant & 1) ? fast_cos_reduced(r) : fast_sin_reduced(r);
+	return (quadrant & 2) ? -val : val;
+}
+
+inline float fast_cos(float radians)
+{
+	float r;
+	int quadrant = fast_trig_reduce(radians, r);
+	float val = (quadrant & 1) ? fast_sin_reduced(r) : fast_cos_reduced(r);
+	return ((quadrant + 1) & 2) ? -val : val;
+}
+
+inline float fast_atan2(float y, float x)
+{
+	float abs_x = fabsf(x);
+	float abs_y = fabsf(y);
+	float max = (abs_x > abs_y) ? abs_x : abs_y;
+	float min = (abs_x > abs_y) ? abs_y : abs_x;
+	if (max == 0.0f) {
+		return 0.0f;
+	}
+
+	float a = min / max;
+	float z = a * a;
+	float p = FAST_ATAN_C7 + (z * FAST_ATAN_C8);
+	p = FAST_ATAN_C6 + (z * p);
+	p = FAST_ATAN_C5 + (z * p);
+	p = FAST_ATAN_C4 + (z * p);
+	p = FAST_ATAN_C3 + (z * p);
+	p = FAST_ATAN_C2 + (z * p);
+	p = FAST_ATAN_C1 + (z * p);
+	float angle = a * (1.0f + (z * p));
+
+	angle = (abs_y > abs_x) ? FAST_TRIG_PI_OVER_2 - angle : angle;
+	angle = (x < 0.0f) ? FAST_TRIG_PI - angle : angle;
+	return (y < 0.0f) ? -angle : angle;
+}
+
+void fast_sin_array(const float *radians, float *sin_out, int count);
+void fast_cos_array(const float *radians, float *cos_out, int count);
+void fast_sincos_array(const float *radians, float *sin_out, float *cos_out, int count);
+void fast_atan2_array(const float *y, const float *x, float *radians_out, int count);
+
+#endif // __SS_MATH_H
\ No newline at end of file
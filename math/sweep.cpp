@@ -0,0 +1,395 @@
+#include "sweep.h"
+
+#include <cfloat>
+
+static inline bool sweep_report_hit(float toi, const vector2 &normal, float *toi_out, vector2 *normal_out)
+{
+	if (toi_out) {
+		*toi_out = toi;
+	}
+	if (normal_out) {
+		*normal_out = normal;
+	}
+	return true;
+}
+
+// Sweep a point against a circle.  Also serves circle against circle, with the
+// radii summed.
+//
+static bool sweep_point_circle(const vector2 &start, const vector2 &velocity, const vector2 &center, float radius,
+	float &toi_out, vector2 &normal_out)
+{
+	vector2 offset = start - center;
+	float c = offset.mag_squared() - SQUARED(radius);
+
+	// already inside.
+	if (c < 0) {
+		toi_out = 0.0f;
+		normal_out = offset.copy_normalize_safe(RIGHT_VECTOR);
+		return true;
+	}
+
+	// not moving, or moving away.
+	float a = velocity.mag_squared();
+	float b = offset.dot(velocity);
+	if (a == 0 || b >= 0) {
+		return false;
+	}
+
+	// misses, or only grazes the edge.
+	float discriminant = SQUARED(b) - a * c;
+	if (discriminant <= 0) {
+		return false;
+	}
+
+	float t = (-b - sqrt(discriminant)) / a;
+	if (t > 1.0f) {
+		return false;
+	}
+
+	toi_out = MAX(t, 0.0f);
+	normal_out = (offset + velocity * toi_out) / radius;
+	return true;
+}
+
+// Sweep a point against a segment grown by radius, ie. a capsule.
+//
+static bool sweep_point_capsule(const vector2 &start, const vector2 &velocity, const vector2 &a, const vector2 &b, float radius,
+	float &toi_out, vector2 &normal_out)
+{
+	vector2 edge = b - a;
+	float len_sq = edge.mag_squared();
+
+	// check whether it starts out inside.
+	float u = 0.0f;
+	if (len_sq > 0) {
+		u = (start - a).dot(edge) / len_sq;
+		u = fl_cap(u, 0.0f, 1.0f);
+	}
+	vector2 offset = start - (a + edge * u);
+	if (offset.mag_squared() < SQUARED(radius)) {
+		toi_out = 0.0f;
+		normal_out = offset.copy_normalize_safe(len_sq > 0 ? edge.lvec() / sqrt(len_sq) : RIGHT_VECTOR);
+		return true;
+	}
+
+	// the flat side facing the start.  If it's hit, nothing can be hit sooner.
+	if (len_sq > 0) {
+		vector2 side = edge.lvec() / sqrt(len_sq);
+		float dist = (start - a).dot(side);
+		if (dist < 0) {
+			side = -side;
+			dist = -dist;
+		}
+
+		float approach = velocity.dot(side);
+		if (approach < 0 && dist >= radius) {
+			float t = (dist - radius) / -approach;
+			if (t <= 1.0f) {
+				float hit_u = (start + velocity * t - a).dot(edge) / len_sq;
+				if (hit_u >= 0.0f && hit_u <= 1.0f) {
+					toi_out = t;
+					normal_out = side;
+					return true;
+				}
+			}
+		}
+	}
+
+	// otherwise it can only hit the rounded ends.
+	float toi_a, toi_b;
+	vector2 normal_a, normal_b;
+	bool hit_a = sweep_point_circle(start, velocity, a, radius, toi_a, normal_a);
+	bool hit_b = len_sq > 0 && sweep_point_circle(start, velocity, b, radius, toi_b, normal_b);
+
+	if (hit_a && (!hit_b || toi_a <= toi_b)) {
+		toi_out = toi_a;
+		normal_out = normal_a;
+		return true;
+	}
+	if (hit_b) {
+		toi_out = toi_b;
+		normal_out = normal_b;
+		return true;
+	}
+	return false;
+}
+
+// Sweep a point against a box grown by radius, with rounded corners.  Everything
+// is in the box's local space, with the box centered on the origin.
+//
+static bool sweep_point_rounded_box(const vector2 &start, const vector2 &velocity, const vector2 &half_size, float radius,
+	float &toi_out, vector2 &normal_out)
+{
+	// starting inside the box itself, push out the least deep side.
+	float depth_x = half_size.x - fl_abs(start.x);
+	float depth_y = half_size.y - fl_abs(start.y);
+	if (depth_x >= 0 && depth_y >= 0) {
+		toi_out = 0.0f;
+		if (depth_x < depth_y) {
+			normal_out = vector2(fl_sign(start.x), 0.0f);
+		} else {
+			normal_out = vector2(0.0f, fl_sign(start.y));
+		}
+		return true;
+	}
+
+	// starting within radius of the box.
+	vector2 closest(fl_cap(start.x, -half_size.x, half_size.x), fl_cap(start.y, -half_size.y, half_size.y));
+	vector2 offset = start - closest;
+	float dist_sq = offset.mag_squared();
+	if (dist_sq < SQUARED(radius)) {
+		toi_out = 0.0f;
+		normal_out = offset / sqrt(dist_sq);
+		return true;
+	}
+
+	// slab test against the box grown by the radius on every side.
+	float pos[2] = {start.x, start.y};
+	float vel[2] = {velocity.x, velocity.y};
+	float outer[2] = {half_size.x + radius, half_size.y + radius};
+
+	float t_enter = 0.0f;
+	float t_exit = 1.0f;
+	int enter_axis = -1;
+	for (int axis = 0; axis < 2; axis++) {
+		if (vel[axis] == 0) {
+			if (fl_abs(pos[axis]) >= outer[axis]) {
+				return false;
+			}
+			continue;
+		}
+
+		float t0 = (-outer[axis] - pos[axis]) / vel[axis];
+		float t1 = (outer[axis] - pos[axis]) / vel[axis];
+		if (t0 > t1) {
+			SWAP(t0, t1, float);
+		}
+
+		if (t0 > t_enter) {
+			t_enter = t0;
+			enter_axis = axis;
+		}
+		t_exit = MIN(t_exit, t1);
+		if (t_enter >= t_exit) {
+			return false;
+		}
+	}
+
+	// entering along a flat side.
+	vector2 hit = start + velocity * t_enter;
+	if (enter_axis >= 0 && (fl_abs(hit.x) <= half_size.x || fl_abs(hit.y) <= half_size.y)) {
+		toi_out = t_enter;
+		if (enter_axis == 0) {
+			normal_out = vector2(fl_sign(hit.x), 0.0f);
+		} else {
+			normal_out = vector2(0.0f, fl_sign(hit.y));
+		}
+		return true;
+	}
+
+	// entering a corner of the grown box, which only counts if it hits the
+	// rounded corner.  It can't reach a flat side without passing through it.
+	vector2 corner(fl_sign(hit.x) * half_size.x, fl_sign(hit.y) * half_size.y);
+	return sweep_point_circle(start, velocity, corner, radius, toi_out, normal_out);
+}
+
+static bool sweep_circle_box_aux(const vector2 &circle_center, float radius, const vector2 &velocity,
+	const vector2 &box_center, const matrix &box_orient, const vector2 &half_size, float &toi_out, vector2 &normal_out)
+{
+	// do the sweep in the box's space.
+	vector2 local_start;
+	world_to_local(circle_center, box_center, box_orient, local_start);
+	vector2 local_velocity = velocity * box_orient;
+
+	vector2 local_normal;
+	if (!sweep_point_rounded_box(local_start, local_velocity, half_size, radius, toi_out, local_normal)) {
+		return false;
+	}
+
+	normal_out = box_orient * local_normal;
+	return true;
+}
+
+// Separating axis test on the boxes' four axes, plus the axis perpendicular to the
+// velocity.  Along each axis, find the span of time where the projections overlap.
+// The boxes touch when the spans from every axis overlap.
+//
+// offset: center of the target relative to the center of the mover.
+//
+static bool sweep_box_box_aux(const vector2 &offset, const vector2 &velocity,
+	const matrix &orient1, const vector2 &half_r1, const vector2 &half_u1,
+	const matrix &orient2, const vector2 &half_r2, const vector2 &half_u2,
+	float &toi_out, vector2 &normal_out)
+{
+	vector2 axes[5] = {orient1.rvec, orient1.uvec, orient2.rvec, orient2.uvec, ZERO_VECTOR};
+	int num_axes = 4;
+
+	// projections never move along the velocity's perpendicular, so it's a plain static test.
+	float speed_sq = velocity.mag_squared();
+	if (speed_sq > 0) {
+		axes[num_axes++] = velocity.lvec() / sqrt(speed_sq);
+	}
+
+	float t_enter = -FLT_MAX;
+	float t_exit = FLT_MAX;
+	vector2 enter_normal = ZERO_VECTOR;
+
+	// for boxes that start out overlapping.
+	float min_depth = FLT_MAX;
+	vector2 depth_normal = ZERO_VECTOR;
+
+	for (int i = 0; i < num_axes; i++) {
+		const vector2 &axis = axes[i];
+
+		float dist = offset.dot(axis);
+		float radius = fl_abs(half_r1.dot(axis)) + fl_abs(half_u1.dot(axis)) +
+			fl_abs(half_r2.dot(axis)) + fl_abs(half_u2.dot(axis));
+		float speed = velocity.dot(axis);
+
+		if (i < 4) {
+			float depth = radius - fl_abs(dist);
+			if (depth < min_depth) {
+				min_depth = depth;
+				depth_normal = (dist > 0) ? -axis : axis;
+			}
+		}
+
+		if (speed == 0) {
+			// separated for the whole step.
+			if (fl_abs(dist) >= radius) {
+				return false;
+			}
+			continue;
+		}
+
+		// the mover's projection overlaps while |dist - speed * t| < radius.
+		float t0 = (dist - radius) / speed;
+		float t1 = (dist + radius) / speed;
+		if (t0 > t1) {
+			SWAP(t0, t1, float);
+		}
+
+		if (t0 > t_enter) {
+			t_enter = t0;
+			enter_normal = (speed > 0) ? -axis : axis;
+		}
+		t_exit = MIN(t_exit, t1);
+	}
+
+	// never overlapping on every axis at once, or not during this step.
+	if (t_enter >= t_exit || t_enter > 1.0f || t_exit <= 0) {
+		return false;
+	}
+
+	if (t_enter < 0) {
+		toi_out = 0.0f;
+		normal_out = depth_normal;
+	} else {
+		toi_out = t_enter;
+		normal_out = enter_normal;
+	}
+	return true;
+}
+
+bool sweep_circle_circle(const bcircle &circle, const vector2 &velocity, const bcircle &target, float *toi_out /*= NULL*/, vector2 *normal_out /*= NULL*/)
+{
+	float toi;
+	vector2 normal;
+	if (!sweep_point_circle(circle.center, velocity, target.center, circle.radius + target.radius, toi, normal)) {
+		return false;
+	}
+	return sweep_report_hit(toi, normal, toi_out, normal_out);
+}
+
+bool sweep_circle_segment(const bcircle &circle, const vector2 &velocity, const line_segment &target, float *toi_out /*= NULL*/, vector2 *normal_out /*= NULL*/)
+{
+	float toi;
+	vector2 normal;
+	if (!sweep_point_capsule(circle.center, velocity, target.a, target.b, circle.radius, toi, normal)) {
+		return false;
+	}
+	return sweep_report_hit(toi, normal, toi_out, normal_out);
+}
+
+bool sweep_circle_box(const bcircle &circle, const vector2 &velocity, const bbox_aligned &target, float *toi_out /*= NULL*/, vector2 *normal_out /*= NULL*/)
+{
+	vector2 center = (target.bbmin + target.bbmax) * 0.5f;
+	vector2 half_size(fl_abs(target.bbmax.x - target.bbmin.x) * 0.5f, fl_abs(target.bbmax.y - target.bbmin.y) * 0.5f);
+
+	float toi;
+	vector2 normal;
+	if (!sweep_circle_box_aux(circle.center, circle.radius, velocity, center, IDENTITY_MATRIX, half_size, toi, normal)) {
+		return false;
+	}
+	return sweep_report_hit(toi, normal, toi_out, normal_out);
+}
+
+bool sweep_circle_box(const bcircle &circle, const vector2 &velocity, const bbox_oriented &target, float *toi_out /*= NULL*/, vector2 *normal_out /*= NULL*/)
+{
+	vector2 half_size(fl_abs(target.size.x) * 0.5f, fl_abs(target.size.y) * 0.5f);
+
+	float toi;
+	vector2 normal;
+	if (!sweep_circle_box_aux(circle.center, circle.radius, velocity, target.center, target.orient, half_size, toi, normal)) {
+		return false;
+	}
+	return sweep_report_hit(toi, normal, toi_out, normal_out);
+}
+
+bool sweep_box_box(const bbox_oriented &box, const vector2 &velocity, const bbox_oriented &target, float *toi_out /*= NULL*/, vector2 *normal_out /*= NULL*/)
+{
+	vector2 half_r1, half_u1, half_r2, half_u2;
+	box.get_extents(half_r1, half_u1);
+	target.get_extents(half_r2, half_u2);
+
+	float toi;
+	vector2 normal;
+	if (!sweep_box_box_aux(target.center - box.center, velocity, box.orient, half_r1, half_u1, target.orient, half_r2, half_u2, toi, normal)) {
+		return false;
+	}
+	return sweep_report_hit(toi, normal, toi_out, normal_out);
+}
+
+// Sweep any pair of shapes.  A moving box against a circle is swept as the circle
+// moving the opposite way.
+//
+bool sweep_shapes(const bounding_shape &mover, const vector2 &velocity, const bounding_shape &target, float *toi_out /*= NULL*/, vector2 *normal_out /*= NULL*/)
+{
+	bool mover_is_circle = mover.type == BAT_CIRCLE;
+	bool target_is_circle = target.type == BAT_CIRCLE;
+	Assert_return_value(mover_is_circle || mover.type == BAT_BOX_ALIGNED || mover.type == BAT_BOX_ORIENTED, false);
+	Assert_return_value(target_is_circle || target.type == BAT_BOX_ALIGNED || target.type == BAT_BOX_ORIENTED, false);
+
+	float toi;
+	vector2 normal;
+	bool hit = false;
+
+	if (mover_is_circle && target_is_circle) {
+		hit = sweep_point_circle(mover.center, velocity, target.center, mover.size.x + target.size.x, toi, normal);
+	} else if (mover_is_circle) {
+		hit = sweep_circle_box_aux(mover.center, mover.size.x, velocity, target.center, target.orient, target.size * 0.5f, toi, normal);
+	} else if (target_is_circle) {
+		hit = sweep_circle_box_aux(target.center, target.size.x, -velocity, mover.center, mover.orient, mover.size * 0.5f, toi, normal);
+		normal = -normal;
+	} else {
+		hit = sweep_box_box_aux(target.center - mover.center, velocity,
+			mover.orient, mover.orient.rvec * (mover.size.x * 0.5f), mover.orient.uvec * (mover.size.y * 0.5f),
+			target.orient, target.orient.rvec * (target.size.x * 0.5f), target.orient.uvec * (target.size.y * 0.5f),
+			toi, normal);
+	}
+
+	if (!hit) {
+		return false;
+	}
+	return sweep_report_hit(toi, normal, toi_out, normal_out);
+}
+
+bool sweep_areas(const bounding_area &mover, const vector2 &velocity, const bounding_area &target, float *toi_out /*= NULL*/, vector2 *normal_out /*= NULL*/)
+{
+	bounding_shape mover_shape, target_shape;
+	mover.get_shape(mover_shape);
+	target.get_shape(target_shape);
+
+	return sweep_shapes(mover_shape, velocity, target_shape, toi_out, normal_out);
+}
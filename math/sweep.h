@@ -0,0 +1,34 @@
+#ifndef __SWEEP_H
+#define __SWEEP_H
+
+#pragma once
+
+#include "bbox.h"
+
+// Continuous collision for moving shapes.  Rather than testing where a shape ends
+// up after a move, these find the time of impact: the earliest point along the
+// move where it first touches the target.  Fast movers can't tunnel through thin
+// geometry, and the caller can stop the mover at the contact.
+//
+// velocity: displacement of the mover over the step, so t runs from 0 at its
+//		starting position to 1 at its end.  To sweep two moving shapes, pass the
+//		mover's velocity minus the target's.
+// toi_out: fraction of the step at which the shapes first touch.
+// normal_out: unit contact normal, pointing from the target toward the mover.
+//
+// Shapes that already overlap at the start report a time of 0, with the normal
+// along which they are least deep.  Shapes that only graze each other do not hit.
+//
+// returns: true if the shapes touch at some t in [0, 1].
+//
+
+bool sweep_circle_circle(const bcircle &circle, const vector2 &velocity, const bcircle &target, float *toi_out = NULL, vector2 *normal_out = NULL);
+bool sweep_circle_segment(const bcircle &circle, const vector2 &velocity, const line_segment &target, float *toi_out = NULL, vector2 *normal_out = NULL);
+bool sweep_circle_box(const bcircle &circle, const vector2 &velocity, const bbox_aligned &target, float *toi_out = NULL, vector2 *normal_out = NULL);
+bool sweep_circle_box(const bcircle &circle, const vector2 &velocity, const bbox_oriented &target, float *toi_out = NULL, vector2 *normal_out = NULL);
+bool sweep_box_box(const bbox_oriented &box, const vector2 &velocity, const bbox_oriented &target, float *toi_out = NULL, vector2 *normal_out = NULL);
+
+bool sweep_shapes(const bounding_shape &mover, const vector2 &velocity, const bounding_shape &target, float *toi_out = NULL, vector2 *normal_out = NULL);
+bool sweep_areas(const bounding_area &mover, const vector2 &velocity, const bounding_area &target, float *toi_out = NULL, vector2 *normal_out = NULL);
+
+#endif // __SWEEP_H
@@ -0,0 +1,120 @@
+#include "transform.h"
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+// returns: the transform that undoes this one.  Asserts if the axes are
+// degenerate (ie. a zero scale), returning the identity.
+//
+transform2 transform2::inverse() const
+{
+	float det = determinant();
+	Assert_return_value(det != 0.0f, IDENTITY_TRANSFORM);
+
+	float inv_det = 1.0f / det;
+	transform2 inv(vector2(yaxis.y * inv_det, -xaxis.y * inv_det), vector2(-yaxis.x * inv_det, xaxis.x * inv_det), ZERO_VECTOR);
+	inv.pos = -inv.apply_vector(pos);
+	return inv;
+}
+
+matrix transform2::get_orient() const
+{
+	matrix orient;
+	orient.make_rvec(xaxis.copy_normalize_safe());
+	return orient;
+}
+
+// returns: the length of each axis, negative on y if the transform mirrors.
+//
+vector2 transform2::get_scale() const
+{
+	float scale_y = yaxis.mag();
+	return vector2(xaxis.mag(), (determinant() < 0.0f) ? -scale_y : scale_y);
+}
+
+void transform2::get_44_matrix(float *dest) const
+{
+	for (uint i = 0; i < 16; i++) {
+		dest[i] = 0.0f;
+	}
+	dest[0] = xaxis.x;
+	dest[1] = xaxis.y;
+	dest[4] = yaxis.x;
+	dest[5] = yaxis.y;
+	dest[10] = 1.0f;
+	dest[12] = pos.x;
+	dest[13] = pos.y;
+	dest[15] = 1.0f;
+}
+
+// Transform an array of points.  points_in and points_out may be the same array.
+//
+void transform_points(const transform2 &t, const vector2 *points_in, vector2 *points_out, int count)
+{
+	int i = 0;
+
+#if defined(__SSE__)
+	// two points to a register, as x0 y0 x1 y1.
+	const __m128 xaxis = _mm_setr_ps(t.xaxis.x, t.xaxis.y, t.xaxis.x, t.xaxis.y);
+	const __m128 yaxis = _mm_setr_ps(t.yaxis.x, t.yaxis.y, t.yaxis.x, t.yaxis.y);
+	const __m128 pos = _mm_setr_ps(t.pos.x, t.pos.y, t.pos.x, t.pos.y);
+
+	const float *in = &points_in[0].x;
+	float *out = &points_out[0].x;
+	for (; i + 4 <= count; i += 4) {
+		__m128 p01 = _mm_loadu_ps(in + (i * 2));
+		__m128 p23 = _mm_loadu_ps(in + (i * 2) + 4);
+
+		__m128 x01 = _mm_shuffle_ps(p01, p01, _MM_SHUFFLE(2, 2, 0, 0));
+		__m128 y01 = _mm_shuffle_ps(p01, p01, _MM_SHUFFLE(3, 3, 1, 1));
+		__m128 x23 = _mm_shuffle_ps(p23, p23, _MM_SHUFFLE(2, 2, 0, 0));
+		__m128 y23 = _mm_shuffle_ps(p23, p23, _MM_SHUFFLE(3, 3, 1, 1));
+
+		__m128 r01 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x01, xaxis), _mm_mul_ps(y01, yaxis)), pos);
+		__m128 r23 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x23, xaxis), _mm_mul_ps(y23, yaxis)), pos);
+
+		_mm_storeu_ps(out + (i * 2), r01);
+		_mm_storeu_ps(out + (i * 2) + 4, r23);
+	}
+#endif
+
+	for (; i < count; i++) {
+		points_out[i] = t.apply(points_in[i]);
+	}
+}
+
+// Transform points stored as separate x and y arrays.  The outputs may be the
+// same arrays as the inputs.
+//
+void transform_points_soa(const transform2 &t, const float *x_in, const float *y_in, float *x_out, float *y_out, int count)
+{
+	int i = 0;
+
+#if defined(__SSE__)
+	const __m128 xx = _mm_set1_ps(t.xaxis.x);
+	const __m128 xy = _mm_set1_ps(t.xaxis.y);
+	const __m128 yx = _mm_set1_ps(t.yaxis.x);
+	const __m128 yy = _mm_set1_ps(t.yaxis.y);
+	const __m128 px = _mm_set1_ps(t.pos.x);
+	const __m128 py = _mm_set1_ps(t.pos.y);
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_loadu_ps(x_in + i);
+		__m128 y = _mm_loadu_ps(y_in + i);
+
+		__m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, xx), _mm_mul_ps(y, yx)), px);
+		__m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, xy), _mm_mul_ps(y, yy)), py);
+
+		_mm_storeu_ps(x_out + i, rx);
+		_mm_storeu_ps(y_out + i, ry);
+	}
+#endif
+
+	for (; i < count; i++) {
+		float x = x_in[i];
+		float y = y_in[i];
+		x_out[i] = (t.xaxis.x * x) + (t.yaxis.x * y) + t.pos.x;
+		y_out[i] = (t.xaxis.y * x) + (t.yaxis.y * y) + t.pos.y;
+	}
+}
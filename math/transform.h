@@ -0,0 +1,87 @@
+#ifndef __TRANSFORM_H
+#define __TRANSFORM_H
+
+#pragma once
+
+#include "matrix.h"
+
+// 2x3 affine transform: rotation and scale in the axes, plus a translation.
+//
+// Unlike matrix, the axes aren't kept unit length, so a transform can carry
+// scale, and products of transforms aren't renormalized.  Nothing here uses
+// trig; inverting takes a determinant, and composing is a handful of multiplies.
+//
+// transform_points and transform_points_soa push whole vertex arrays through a
+// transform, with SSE when the compiler targets it.
+//
+
+class transform2 {
+public:
+	vector2 xaxis;			// where local (1, 0) points, scaled.
+	vector2 yaxis;			// where local (0, 1) points, scaled.
+	vector2 pos;
+
+	transform2() : xaxis(1.0f, 0.0f), yaxis(0.0f, 1.0f), pos(0.0f, 0.0f) {}
+	transform2(const vector2 &_xaxis, const vector2 &_yaxis, const vector2 &_pos) : xaxis(_xaxis), yaxis(_yaxis), pos(_pos) {}
+	transform2(const vector2 &_pos, const matrix &orient) : xaxis(orient.rvec), yaxis(orient.uvec), pos(_pos) {}
+	transform2(const vector2 &_pos, const matrix &orient, const vector2 &scale)
+		: xaxis(orient.rvec * scale.x), yaxis(orient.uvec * scale.y), pos(_pos) {}
+
+	const bool operator == (const transform2 &t) const {
+		return (xaxis == t.xaxis) && (yaxis == t.yaxis) && (pos == t.pos);
+	}
+	const bool operator != (const transform2 &t) const {
+		return !(t == *this);
+	}
+
+	inline void set_identity() {
+		xaxis = vector2(1.0f, 0.0f);
+		yaxis = vector2(0.0f, 1.0f);
+		pos = vector2(0.0f, 0.0f);
+	}
+
+	inline float determinant() const {
+		return (xaxis.x * yaxis.y) - (xaxis.y * yaxis.x);
+	}
+
+	// Local point to world.
+	inline vector2 apply(const vector2 &v) const {
+		return vector2((xaxis.x * v.x) + (yaxis.x * v.y) + pos.x, (xaxis.y * v.x) + (yaxis.y * v.y) + pos.y);
+	}
+
+	// Local direction to world, ignoring the translation.
+	inline vector2 apply_vector(const vector2 &v) const {
+		return vector2((xaxis.x * v.x) + (yaxis.x * v.y), (xaxis.y * v.x) + (yaxis.y * v.y));
+	}
+
+	// World point to local.  For more than a point or two, invert once and
+	// apply that instead.
+	inline vector2 apply_inverse(const vector2 &v) const {
+		return inverse().apply(v);
+	}
+
+	transform2 inverse() const;
+
+	// Transform that applies t first, then this.
+	const transform2 operator * (const transform2 &t) const {
+		return transform2(apply_vector(t.xaxis), apply_vector(t.yaxis), apply(t.pos));
+	}
+	const transform2& operator *= (const transform2 &t) {
+		*this = *this * t;
+		return *this;
+	}
+
+	// The rotation alone, with scale taken out.
+	matrix get_orient() const;
+	vector2 get_scale() const;
+
+	// Copy into a column-major 4x4 matrix for openGL.
+	void get_44_matrix(float *dest) const;
+};
+
+const transform2 IDENTITY_TRANSFORM;
+
+void transform_points(const transform2 &t, const vector2 *points_in, vector2 *points_out, int count);
+void transform_points_soa(const transform2 &t, const float *x_in, const float *y_in, float *x_out, float *y_out, int count);
+
+#endif // __TRANSFORM_H
@@ -0,0 +1,377 @@
+#include "transform_hierarchy.h"
+
+#include <cstring>
+
+transform_hierarchy::transform_hierarchy(int max_nodes)
+{
+	Assert(max_nodes > 0);
+	m_max_nodes = MAX(max_nodes, 1);
+
+	m_parent = new int[m_max_nodes];
+	m_handle = new int[m_max_nodes];
+	m_depth = new int[m_max_nodes];
+	m_local_pos = new vector2[m_max_nodes];
+	m_local_orient = new matrix[m_max_nodes];
+	m_world_pos = new vector2[m_max_nodes];
+	m_world_orient = new matrix[m_max_nodes];
+	m_dirty = new unsigned char[m_max_nodes];
+	m_changed = new unsigned char[m_max_nodes];
+	m_removed = new unsigned char[m_max_nodes];
+
+	m_slot = new int[m_max_nodes];
+	m_next_free = new int[m_max_nodes];
+
+	// the ints double as a count per depth, and depths are under m_max_nodes.
+	m_order = new int[m_max_nodes];
+	m_scratch_ints = new int[m_max_nodes];
+	m_scratch_bytes = new unsigned char[m_max_nodes];
+	m_scratch_vectors = new vector2[m_max_nodes];
+	m_scratch_matrices = new matrix[m_max_nodes];
+
+	clear();
+}
+
+transform_hierarchy::~transform_hierarchy()
+{
+	delete [] m_parent;
+	delete [] m_handle;
+	delete [] m_depth;
+	delete [] m_local_pos;
+	delete [] m_local_orient;
+	delete [] m_world_pos;
+	delete [] m_world_orient;
+	delete [] m_dirty;
+	delete [] m_changed;
+	delete [] m_removed;
+	delete [] m_slot;
+	delete [] m_next_free;
+	delete [] m_order;
+	delete [] m_scratch_ints;
+	delete [] m_scratch_bytes;
+	delete [] m_scratch_vectors;
+	delete [] m_scratch_matrices;
+}
+
+void transform_hierarchy::clear()
+{
+	for (int i = 0; i < m_max_nodes; i++) {
+		m_slot[i] = -1;
+		m_next_free[i] = i + 1;
+	}
+	m_next_free[m_max_nodes - 1] = -1;
+	m_first_free = 0;
+
+	m_count = 0;
+	m_any_dirty = false;
+	m_any_changed = false;
+	m_needs_sort = false;
+}
+
+// returns: the slot a handle currently lives in, or -1 (and asserts) if the
+// handle isn't in use.
+//
+int transform_hierarchy::get_slot(int handle) const
+{
+	Assert_return_value(handle >= 0 && handle < m_max_nodes, -1);
+	Assert_return_value(m_slot[handle] >= 0, -1);
+	return m_slot[handle];
+}
+
+// Add a node.  parent_handle is -1 for a node with no parent, in which case its
+// local transform is its world transform.
+//
+// returns: the new node's handle, or -1 if the hierarchy is full.
+//
+int transform_hierarchy::add(int parent_handle, const vector2 &local_pos, const matrix &local_orient)
+{
+	int parent_slot = -1;
+	if (parent_handle >= 0) {
+		parent_slot = get_slot(parent_handle);
+		Assert_return_value(parent_slot >= 0, -1);
+	}
+	Assert_return_value(m_first_free >= 0, -1);
+
+	int handle = m_first_free;
+	m_first_free = m_next_free[handle];
+
+	// appending keeps parents ahead of children.
+	int slot = m_count++;
+	m_slot[handle] = slot;
+	m_handle[slot] = handle;
+	m_parent[slot] = parent_slot;
+	m_depth[slot] = (parent_slot >= 0) ? m_depth[parent_slot] + 1 : 0;
+	m_local_pos[slot] = local_pos;
+	m_local_orient[slot] = local_orient;
+	m_world_pos[slot] = local_pos;
+	m_world_orient[slot] = local_orient;
+	m_dirty[slot] = 1;
+	m_changed[slot] = 0;
+	m_any_dirty = true;
+
+	return handle;
+}
+
+// Remove a node, along with everything attached to it.
+//
+void transform_hierarchy::remove(int handle)
+{
+	int slot = get_slot(handle);
+	Assert_return(slot >= 0);
+
+	// the pass below needs parents first.
+	if (m_needs_sort) {
+		sort_by_depth();
+	}
+	slot = m_slot[handle];
+
+	int new_count = 0;
+	for (int i = 0; i < m_count; i++) {
+		int parent = m_parent[i];
+		m_removed[i] = (i == slot) || (parent >= 0 && m_removed[parent]);
+
+		if (m_removed[i]) {
+			int removed_handle = m_handle[i];
+			m_slot[removed_handle] = -1;
+			m_next_free[removed_handle] = m_first_free;
+			m_first_free = removed_handle;
+		} else {
+			m_order[new_count++] = i;
+		}
+	}
+
+	apply_order(new_count);
+}
+
+// Attach a node to a different parent, or to none with -1.  The local
+// transform is kept, so the node moves along with its new parent.
+//
+void transform_hierarchy::set_parent(int handle, int parent_handle)
+{
+	int slot = get_slot(handle);
+	Assert_return(slot >= 0);
+
+	int parent_slot = -1;
+	if (parent_handle >= 0) {
+		parent_slot = get_slot(parent_handle);
+		Assert_return(parent_slot >= 0);
+
+		// can't attach a node to itself or anything below it.
+		for (int check = parent_slot; check >= 0; check = m_parent[check]) {
+			Assert_return(check != slot);
+		}
+	}
+
+	m_parent[slot] = parent_slot;
+	m_dirty[slot] = 1;
+	m_any_dirty = true;
+
+	if (parent_slot > slot) {
+		m_needs_sort = true;
+	}
+}
+
+void transform_hierarchy::set_local(int handle, const vector2 &local_pos, const matrix &local_orient)
+{
+	int slot = get_slot(handle);
+	Assert_return(slot >= 0);
+
+	m_local_pos[slot] = local_pos;
+	m_local_orient[slot] = local_orient;
+	m_dirty[slot] = 1;
+	m_any_dirty = true;
+}
+
+void transform_hierarchy::set_local_pos(int handle, const vector2 &local_pos)
+{
+	int slot = get_slot(handle);
+	Assert_return(slot >= 0);
+
+	m_local_pos[slot] = local_pos;
+	m_dirty[slot] = 1;
+	m_any_dirty = true;
+}
+
+void transform_hierarchy::set_local_orient(int handle, const matrix &local_orient)
+{
+	int slot = get_slot(handle);
+	Assert_return(slot >= 0);
+
+	m_local_orient[slot] = local_orient;
+	m_dirty[slot] = 1;
+	m_any_dirty = true;
+}
+
+// Recompute world transforms for everything that was set since the last update,
+// and everything attached to those.
+//
+void transform_hierarchy::update()
+{
+	if (m_needs_sort) {
+		sort_by_depth();
+	}
+
+	if (!m_any_dirty) {
+		if (m_any_changed) {
+			memset(m_changed, 0, m_count);
+			m_any_changed = false;
+		}
+		return;
+	}
+
+	for (int i = 0; i < m_count; i++) {
+		int parent = m_parent[i];
+		bool changed = m_dirty[i] || (parent >= 0 && m_changed[parent]);
+		m_changed[i] = changed;
+		m_dirty[i] = 0;
+
+		if (!changed) {
+			continue;
+		}
+
+		if (parent >= 0) {
+			local_to_world(m_local_pos[i], m_local_orient[i], m_world_pos[parent], m_world_orient[parent], m_world_pos[i], m_world_orient[i]);
+		} else {
+			m_world_pos[i] = m_local_pos[i];
+			m_world_orient[i] = m_local_orient[i];
+		}
+	}
+
+	m_any_dirty = false;
+	m_any_changed = true;
+}
+
+// Put the arrays back in parent-first order after a reparent, with a stable
+// counting sort on depth.
+//
+void transform_hierarchy::sort_by_depth()
+{
+	m_needs_sort = false;
+
+	// parents may be anywhere, so walk each chain up.
+	int max_depth = 0;
+	for (int i = 0; i < m_count; i++) {
+		int depth = 0;
+		for (int parent = m_parent[i]; parent >= 0; parent = m_parent[parent]) {
+			depth++;
+		}
+		m_depth[i] = depth;
+		max_depth = MAX(max_depth, depth);
+	}
+
+	int *depth_start = m_scratch_ints;
+	memset(depth_start, 0, (max_depth + 1) * sizeof(int));
+	for (int i = 0; i < m_count; i++) {
+		depth_start[m_depth[i]]++;
+	}
+
+	int offset = 0;
+	for (int depth = 0; depth <= max_depth; depth++) {
+		int num = depth_start[depth];
+		depth_start[depth] = offset;
+		offset += num;
+	}
+
+	for (int i = 0; i < m_count; i++) {
+		m_order[depth_start[m_depth[i]]++] = i;
+	}
+
+	apply_order(m_count);
+}
+
+// Rearrange the per-slot values into a new order.
+//
+template <class T>
+static void reorder(T *values, const int *order, int count, T *scratch)
+{
+	for (int i = 0; i < count; i++) {
+		scratch[i] = values[order[i]];
+	}
+	for (int i = 0; i < count; i++) {
+		values[i] = scratch[i];
+	}
+}
+
+// Move the slots listed in m_order to the front, in that order, dropping the
+// rest.  Parent links and handles follow them.
+//
+void transform_hierarchy::apply_order(int new_count)
+{
+	// parents as handles, since the slots are about to move.
+	for (int i = 0; i < m_count; i++) {
+		int parent = m_parent[i];
+		m_parent[i] = (parent >= 0) ? m_handle[parent] : -1;
+	}
+
+	reorder(m_parent, m_order, new_count, m_scratch_ints);
+	reorder(m_handle, m_order, new_count, m_scratch_ints);
+	reorder(m_depth, m_order, new_count, m_scratch_ints);
+	reorder(m_local_pos, m_order, new_count, m_scratch_vectors);
+	reorder(m_local_orient, m_order, new_count, m_scratch_matrices);
+	reorder(m_world_pos, m_order, new_count, m_scratch_vectors);
+	reorder(m_world_orient, m_order, new_count, m_scratch_matrices);
+	reorder(m_dirty, m_order, new_count, m_scratch_bytes);
+	reorder(m_changed, m_order, new_count, m_scratch_bytes);
+	m_count = new_count;
+
+	for (int i = 0; i < m_count; i++) {
+		m_slot[m_handle[i]] = i;
+	}
+	for (int i = 0; i < m_count; i++) {
+		int parent = m_parent[i];
+		m_parent[i] = (parent >= 0) ? m_slot[parent] : -1;
+	}
+}
+
+int transform_hierarchy::get_parent(int handle) const
+{
+	int slot = get_slot(handle);
+	Assert_return_value(slot >= 0, -1);
+
+	int parent = m_parent[slot];
+	return (parent >= 0) ? m_handle[parent] : -1;
+}
+
+const vector2& transform_hierarchy::get_local_pos(int handle) const
+{
+	int slot = get_slot(handle);
+	Assert_return_value(slot >= 0, ZERO_VECTOR);
+	return m_local_pos[slot];
+}
+
+const matrix& transform_hierarchy::get_local_orient(int handle) const
+{
+	int slot = get_slot(handle);
+	Assert_return_value(slot >= 0, IDENTITY_MATRIX);
+	return m_local_orient[slot];
+}
+
+const vector2& transform_hierarchy::get_world_pos(int handle) const
+{
+	int slot = get_slot(handle);
+	Assert_return_value(slot >= 0, ZERO_VECTOR);
+	return m_world_pos[slot];
+}
+
+const matrix& transform_hierarchy::get_world_orient(int handle) const
+{
+	int slot = get_slot(handle);
+	Assert_return_value(slot >= 0, IDENTITY_MATRIX);
+	return m_world_orient[slot];
+}
+
+transform2 transform_hierarchy::get_world_transform(int handle) const
+{
+	int slot = get_slot(handle);
+	Assert_return_value(slot >= 0, IDENTITY_TRANSFORM);
+	return transform2(m_world_pos[slot], m_world_orient[slot]);
+}
+
+// returns: whether the node's world transform was recomputed by the last
+// update(), ie. whether anything drawn from it needs refreshing.
+//
+bool transform_hierarchy::was_changed(int handle) const
+{
+	int slot = get_slot(handle);
+	Assert_return_value(slot >= 0, false);
+	return m_changed[slot] != 0;
+}
@@ -0,0 +1,85 @@
+#ifndef __TRANSFORM_HIERARCHY_H
+#define __TRANSFORM_HIERARCHY_H
+
+#pragma once
+
+#include "transform.h"
+
+// Parented transforms, ie. objects attached to other objects.
+//
+// Each node has a position and orientation relative to its parent, and a cached
+// world position and orientation.  Nodes live in flat arrays sorted so every
+// parent comes before its children, which makes update() a single pass from
+// front to back.  Only nodes that changed, or whose parent's world transform
+// changed, are recomputed; the rest cost a couple of byte compares.
+//
+// Nodes are referred to by handle, which stays put while the arrays get
+// reordered underneath.  Reparenting onto a node later in the arrays re-sorts
+// them on the next update, so it's best kept out of every frame.
+//
+
+class transform_hierarchy {
+	private:
+		// per slot, in parent-first order.
+		int *m_parent;				// slot of the parent, -1 for roots
+		int *m_handle;
+		int *m_depth;
+		vector2 *m_local_pos;
+		matrix *m_local_orient;
+		vector2 *m_world_pos;
+		matrix *m_world_orient;
+		unsigned char *m_dirty;		// local transform set since the last update
+		unsigned char *m_changed;	// world transform recomputed by the last update
+		unsigned char *m_removed;
+
+		// per handle.
+		int *m_slot;				// -1 while free
+		int *m_next_free;
+		int m_first_free;
+
+		// scratch for reordering, one array per type that gets moved.
+		int *m_order;
+		int *m_scratch_ints;
+		unsigned char *m_scratch_bytes;
+		vector2 *m_scratch_vectors;
+		matrix *m_scratch_matrices;
+
+		int m_count;
+		int m_max_nodes;
+		bool m_any_dirty;
+		bool m_any_changed;
+		bool m_needs_sort;
+
+		int get_slot(int handle) const;
+		void sort_by_depth();
+		void apply_order(int new_count);
+
+	public:
+		transform_hierarchy(int max_nodes);
+		~transform_hierarchy();
+
+		int add(int parent_handle, const vector2 &local_pos, const matrix &local_orient);
+		void remove(int handle);
+		void set_parent(int handle, int parent_handle);
+		void clear();
+
+		void set_local(int handle, const vector2 &local_pos, const matrix &local_orient);
+		void set_local_pos(int handle, const vector2 &local_pos);
+		void set_local_orient(int handle, const matrix &local_orient);
+
+		void update();
+
+		int get_parent(int handle) const;
+		const vector2& get_local_pos(int handle) const;
+		const matrix& get_local_orient(int handle) const;
+
+		// world values are as of the last update().
+		const vector2& get_world_pos(int handle) const;
+		const matrix& get_world_orient(int handle) const;
+		transform2 get_world_transform(int handle) const;
+		bool was_changed(int handle) const;
+
+		int get_num_nodes() const {return m_count;}
+};
+
+#endif // __TRANSFORM_HIERARCHY_H
@@ -143,11 +143,10 @@ public:
 		return fl_equals(mag_squared(), 1.0f, VECTOR_NORMALIZE_TOLERANCE);
 	}
 	inline float extract_heading() const {
-		return (x != 0 || y != 0) ? atan2(y, x) : 0.0f;
+		return (x != 0 || y != 0) ? fl_atan2(y, x) : 0.0f;
 	}
 	inline void make_heading(float heading) {
-		x = fl_cos(heading);
-		y = fl_sin(heading);
+		fl_sincos(heading, y, x);
 	}
 	void rotate(const float theta);
 	void normalize_safe( const vector2 &default_val = vector2(1.0f, 0.0f) );
@@ -164,4 +163,4 @@ const vector2 UP_VECTOR(0.0f, 1.0f);
 
 const vector2 RIGHT_VECTOR(1.0f, 0.0f);
 
-#endif // __VECTOR_H
\ No newline at end of file
+#endif // __VECTOR_H
\ No newline at end of file
@@ -0,0 +1,297 @@
+#include "visibility.h"
+
+#include <cstdlib>
+
+// The bounding box adds four walls of its own.
+#define VISIBILITY_NUM_BOUNDS		(4)
+
+static inline float visibility_cross(const vector2 &a, const vector2 &b)
+{
+	return (a.x * b.y) - (a.y * b.x);
+}
+
+static inline int visibility_side(const vector2 &a, const vector2 &b, const vector2 &pt)
+{
+	float cross = visibility_cross(b - a, pt - a);
+	return (cross > 0.0f) ? 1 : ((cross < 0.0f) ? -1 : 0);
+}
+
+// A stand-in for atan2 that sorts directions the same way, counterclockwise from
+// +x, in [0, 4).
+//
+static inline float visibility_pseudo_angle(const vector2 &dir)
+{
+	float p = dir.y / (fl_abs(dir.x) + fl_abs(dir.y));
+	if (dir.x < 0.0f) {
+		return 2.0f - p;
+	} else if (dir.y < 0.0f) {
+		return 4.0f + p;
+	}
+	return p;
+}
+
+static int visibility_event_cmp(const void *a, const void *b)
+{
+	const visibility_event *event_a = (const visibility_event*)a;
+	const visibility_event *event_b = (const visibility_event*)b;
+
+	if (event_a->angle != event_b->angle) {
+		return (event_a->angle < event_b->angle) ? -1 : 1;
+	}
+
+	// ends before beginnings, so segments meeting at a corner are never both open.
+	if (event_a->begin != event_b->begin) {
+		return event_a->begin - event_b->begin;
+	}
+	return event_a->seg - event_b->seg;
+}
+
+// Clip a segment to a box.
+//
+// returns: false if none of it is inside.
+//
+static bool visibility_clip(const bbox_aligned &bounds, vector2 &a, vector2 &b)
+{
+	vector2 delta = b - a;
+	float t_min = 0.0f;
+	float t_max = 1.0f;
+
+	for (int axis = 0; axis < 2; axis++) {
+		float s = (axis == 0) ? a.x : a.y;
+		float d = (axis == 0) ? delta.x : delta.y;
+		float lo = (axis == 0) ? bounds.bbmin.x : bounds.bbmin.y;
+		float hi = (axis == 0) ? bounds.bbmax.x : bounds.bbmax.y;
+
+		if (d == 0.0f) {
+			if (s < lo || s > hi) {
+				return false;
+			}
+			continue;
+		}
+
+		float t1 = (lo - s) / d;
+		float t2 = (hi - s) / d;
+		t_min = MAX(t_min, MIN(t1, t2));
+		t_max = MIN(t_max, MAX(t1, t2));
+		if (t_min > t_max) {
+			return false;
+		}
+	}
+
+	vector2 start = a;
+	if (t_max < 1.0f) {
+		b = start + (delta * t_max);
+	}
+	if (t_min > 0.0f) {
+		a = start + (delta * t_min);
+	}
+
+	// make sure clipped ends land exactly on the box, so they meet its edges.
+	a.x = fl_cap(a.x, bounds.bbmin.x, bounds.bbmax.x);
+	a.y = fl_cap(a.y, bounds.bbmin.y, bounds.bbmax.y);
+	b.x = fl_cap(b.x, bounds.bbmin.x, bounds.bbmax.x);
+	b.y = fl_cap(b.y, bounds.bbmin.y, bounds.bbmax.y);
+	return true;
+}
+
+// Distance to a segment along the sweep ray, in units of the ray's length.
+//
+float visibility_compare::dist(int seg) const
+{
+	const visibility_segment &s = segs[seg];
+	vector2 delta = s.b - s.a;
+	float denom = visibility_cross(ray, delta);
+	if (denom == 0.0f) {
+		return MIN((s.a - origin).mag(), (s.b - origin).mag()) / ray.mag();
+	}
+	return visibility_cross(s.a - origin, delta) / denom;
+}
+
+// returns: true if segment a is in front of segment b along the sweep ray.
+//
+bool visibility_compare::operator () (int a, int b) const
+{
+	float dist_a = dist(a);
+	float dist_b = dist(b);
+	float tolerance = MAX(dist_a, dist_b) * 0.00001f;
+	if (dist_a < dist_b - tolerance) {
+		return true;
+	} else if (dist_b < dist_a - tolerance) {
+		return false;
+	}
+
+	// they meet on the ray, ie. at a shared corner, so look at which side of each
+	// other they're on.  If all of b is on the far side of a, a is in front.
+	const visibility_segment &seg_a = segs[a];
+	const visibility_segment &seg_b = segs[b];
+
+	int b_side_1 = visibility_side(seg_a.a, seg_a.b, seg_b.a);
+	int b_side_2 = visibility_side(seg_a.a, seg_a.b, seg_b.b);
+	if (b_side_1 * b_side_2 >= 0 && b_side_1 + b_side_2 != 0) {
+		return (b_side_1 + b_side_2 > 0) != (visibility_side(seg_a.a, seg_a.b, origin) > 0);
+	}
+
+	int a_side_1 = visibility_side(seg_b.a, seg_b.b, seg_a.a);
+	int a_side_2 = visibility_side(seg_b.a, seg_b.b, seg_a.b);
+	if (a_side_1 * a_side_2 >= 0 && a_side_1 + a_side_2 != 0) {
+		return (a_side_1 + a_side_2 > 0) == (visibility_side(seg_b.a, seg_b.b, origin) > 0);
+	}
+
+	return a < b;
+}
+
+// max_segments: most segments that will be passed to compute().
+//
+visibility_polygon::visibility_polygon(int max_segments)
+{
+	Assert(max_segments >= 0);
+
+	m_max_segs = MAX(max_segments, 0) + VISIBILITY_NUM_BOUNDS;
+	m_segs = new visibility_segment[m_max_segs];
+	m_events = new visibility_event[m_max_segs * 2];
+
+	// each group of events adds at most two points.
+	m_points = new vector2[m_max_segs * 4];
+	m_num_points = 0;
+
+	visibility_compare compare;
+	compare.segs = m_segs;
+	m_heap = new index_heap<visibility_compare>(m_max_segs, compare);
+}
+
+visibility_polygon::~visibility_polygon()
+{
+	delete [] m_segs;
+	delete [] m_events;
+	delete [] m_points;
+	delete m_heap;
+}
+
+void visibility_polygon::add_point(const vector2 &pt)
+{
+	if (m_num_points > 0 && m_points[m_num_points - 1].equals(pt, 0.0001f)) {
+		return;
+	}
+	m_points[m_num_points++] = pt;
+}
+
+// Find what can be seen from a point.
+//
+// origin: the viewer.  Must be inside the bounds.
+// segs: segments that block sight.
+// bounds: how far the viewer can see.  Segments are clipped to it.
+//
+// returns: number of vertices in the polygon, which are in counterclockwise order
+//		and can be read with get_points().
+//
+int visibility_polygon::compute(const vector2 &origin, const line_segment *segs, int num_segs, const bbox_aligned &bounds)
+{
+	Assert_return_value(segs || num_segs == 0, 0);
+	Assert_return_value(num_segs + VISIBILITY_NUM_BOUNDS <= m_max_segs, 0);
+	Assert_return_value(bbox_intersects_point(bounds, origin), 0);
+
+	m_num_points = 0;
+	m_heap->clear();
+
+	// the bounds go first, counterclockwise so they face the viewer.
+	vector2 corners[VISIBILITY_NUM_BOUNDS] = {
+		bounds.bbmin,
+		vector2(bounds.bbmax.x, bounds.bbmin.y),
+		bounds.bbmax,
+		vector2(bounds.bbmin.x, bounds.bbmax.y)
+	};
+
+	int num_used = 0;
+	for (int i = 0; i < num_segs + VISIBILITY_NUM_BOUNDS; i++) {
+		vector2 a, b;
+		if (i < VISIBILITY_NUM_BOUNDS) {
+			a = corners[i];
+			b = corners[(i + 1) % VISIBILITY_NUM_BOUNDS];
+		} else {
+			a = segs[i - VISIBILITY_NUM_BOUNDS].a;
+			b = segs[i - VISIBILITY_NUM_BOUNDS].b;
+			if (!visibility_clip(bounds, a, b)) {
+				continue;
+			}
+		}
+
+		// segments seen edge-on don't block anything.
+		float cross = visibility_cross(a - origin, b - origin);
+		if (cross == 0.0f) {
+			continue;
+		} else if (cross < 0.0f) {
+			SWAP(a, b, vector2);
+		}
+
+		m_segs[num_used].a = a;
+		m_segs[num_used].b = b;
+		num_used++;
+	}
+
+	int num_events = 0;
+	m_heap->compare.origin = origin;
+	m_heap->compare.ray = RIGHT_VECTOR;
+	for (int i = 0; i < num_used; i++) {
+		float angle_a = visibility_pseudo_angle(m_segs[i].a - origin);
+		float angle_b = visibility_pseudo_angle(m_segs[i].b - origin);
+
+		m_events[num_events].angle = angle_a;
+		m_events[num_events].seg = i;
+		m_events[num_events].begin = 1;
+		num_events++;
+
+		m_events[num_events].angle = angle_b;
+		m_events[num_events].seg = i;
+		m_events[num_events].begin = 0;
+		num_events++;
+
+		// already open when the sweep starts.
+		if (angle_a > angle_b) {
+			m_heap->push(i);
+		}
+	}
+
+	qsort(m_events, num_events, sizeof(visibility_event), visibility_event_cmp);
+
+	for (int i = 0; i < num_events; ) {
+		const visibility_event &event = m_events[i];
+		const visibility_segment &event_seg = m_segs[event.seg];
+		m_heap->compare.ray = (event.begin ? event_seg.a : event_seg.b) - origin;
+
+		int nearest = m_heap->empty() ? -1 : m_heap->top();
+
+		// handle every event at this angle before looking at what changed.
+		int last = i;
+		while (last < num_events && m_events[last].angle == event.angle) {
+			last++;
+		}
+		for (int j = i; j < last; j++) {
+			if (m_events[j].begin) {
+				m_heap->push(m_events[j].seg);
+			} else if (m_heap->contains(m_events[j].seg)) {
+				m_heap->remove(m_events[j].seg);
+			}
+		}
+		i = last;
+
+		int new_nearest = m_heap->empty() ? -1 : m_heap->top();
+		if (new_nearest == nearest) {
+			continue;
+		}
+
+		const vector2 &ray = m_heap->compare.ray;
+		if (nearest >= 0) {
+			add_point(origin + (ray * m_heap->compare.dist(nearest)));
+		}
+		if (new_nearest >= 0) {
+			add_point(origin + (ray * m_heap->compare.dist(new_nearest)));
+		}
+	}
+
+	// the sweep ends where it began.
+	if (m_num_points > 1 && m_points[m_num_points - 1].equals(m_points[0], 0.0001f)) {
+		m_num_points--;
+	}
+
+	return m_num_points;
+}
@@ -0,0 +1,70 @@
+#ifndef __VISIBILITY_H
+#define __VISIBILITY_H
+
+#pragma once
+
+#include "bbox.h"
+#include "../structures/index_heap.h"
+
+// Computes the polygon visible from a point, given a set of line_segments that
+// block sight, ie. for field of view or lighting.
+//
+// This is an angular sweep: segment endpoints are sorted by angle around the
+// viewer, and a ray swept once around the circle keeps the segments it's
+// crossing in a heap ordered by distance.  Wherever the nearest segment changes,
+// the polygon gets a vertex on the old nearest and one on the new, so the whole
+// thing is O(n log n) rather than a ray per direction.
+//
+// Segments may share endpoints, but shouldn't otherwise cross each other.
+// Everything is clipped to a bounding box, whose edges close off the polygon.
+//
+// All scratch space is allocated up front and reused between calls.
+//
+
+// A segment as seen from the viewer, running counterclockwise from a to b.
+struct visibility_segment {
+	vector2 a;
+	vector2 b;
+};
+
+struct visibility_event {
+	float angle;
+	int seg;
+	int begin;					// 1 where the segment starts, 0 where it ends.
+};
+
+// Orders the segments crossing the sweep ray, nearest first.
+struct visibility_compare {
+	visibility_compare() : segs(NULL), origin(ZERO_VECTOR), ray(RIGHT_VECTOR) {}
+
+	const visibility_segment *segs;
+	vector2 origin;
+	vector2 ray;
+
+	float dist(int seg) const;
+	bool operator () (int a, int b) const;
+};
+
+class visibility_polygon {
+	private:
+		visibility_segment *m_segs;
+		visibility_event *m_events;
+		int m_max_segs;
+		index_heap<visibility_compare> *m_heap;
+
+		vector2 *m_points;
+		int m_num_points;
+
+		void add_point(const vector2 &pt);
+
+	public:
+		visibility_polygon(int max_segments);
+		~visibility_polygon();
+
+		int compute(const vector2 &origin, const line_segment *segs, int num_segs, const bbox_aligned &bounds);
+
+		const vector2 *get_points() const {return m_points;}
+		int get_num_points() const {return m_num_points;}
+};
+
+#endif // __VISIBILITY_H
@@ -0,0 +1,167 @@
+#ifndef __INDEX_HEAP_H
+#define __INDEX_HEAP_H
+
+#pragma once
+
+#include "../util.h"
+
+// index_heap is a binary heap of integer ids in the range [0, max_items), with a
+// fixed memory footprint.  It remembers where each id sits, so any id can be
+// removed or re-sorted in place, not just the top one.
+//
+// Ordering comes from a comparison object, called as compare(a, b) and returning
+// true if a belongs above b.  The object is public, so it can carry whatever
+// state it needs, ie. a pointer to an array of costs.  If that state changes for
+// an id already in the heap, call update() on it.
+//
+
+template <class Compare>
+class index_heap {
+	int *m_heap;
+	int *m_pos;				// where each id sits in m_heap, or -1 if it's not in the heap.
+	int m_size;
+	int m_max_items;
+
+	void sift_up(int index);
+	void sift_down(int index);
+	void place(int id, int index) {m_heap[index] = id; m_pos[id] = index;}
+
+public:
+	Compare compare;
+
+	index_heap(int max_items, const Compare &_compare = Compare())
+		: compare(_compare)
+	{
+		Assert(max_items >= 1);
+
+		m_max_items = MAX(1, max_items);
+		m_heap = new int[m_max_items];
+		m_pos = new int[m_max_items];
+		m_size = 0;
+		for (int i = 0; i < m_max_items; i++) {
+			m_pos[i] = -1;
+		}
+	}
+	~index_heap()
+	{
+		delete [] m_heap;
+		delete [] m_pos;
+	}
+
+	inline int size() const {return m_size;}
+	inline int max_size() const {return m_max_items;}
+	inline bool empty() const {return m_size == 0;}
+	inline bool contains(int id) const {return id >= 0 && id < m_max_items && m_pos[id] >= 0;}
+	inline int top() const {Assert(m_size > 0); return m_heap[0];}
+
+	void push(int id);
+	int pop();
+	void remove(int id);
+	void update(int id);
+	void clear();
+};
+
+template <class Compare>
+void index_heap<Compare>::sift_up(int index)
+{
+	int id = m_heap[index];
+	while (index > 0) {
+		int parent = (index - 1) / 2;
+		if (!compare(id, m_heap[parent])) {
+			break;
+		}
+		place(m_heap[parent], index);
+		index = parent;
+	}
+	place(id, index);
+}
+
+template <class Compare>
+void index_heap<Compare>::sift_down(int index)
+{
+	int id = m_heap[index];
+	while (true) {
+		int child = (index * 2) + 1;
+		if (child >= m_size) {
+			break;
+		}
+		if (child + 1 < m_size && compare(m_heap[child + 1], m_heap[child])) {
+			child++;
+		}
+		if (!compare(m_heap[child], id)) {
+			break;
+		}
+		place(m_heap[child], index);
+		index = child;
+	}
+	place(id, index);
+}
+
+template <class Compare>
+void index_heap<Compare>::push(int id)
+{
+	Assert_return(id >= 0 && id < m_max_items);
+	if (m_pos[id] >= 0) {
+		update(id);
+		return;
+	}
+
+	place(id, m_size++);
+	sift_up(m_size - 1);
+}
+
+// Take the top id off the heap.
+//
+// returns: the id, or -1 if the heap is empty.
+//
+template <class Compare>
+int index_heap<Compare>::pop()
+{
+	Assert_return_value(m_size > 0, -1);
+
+	int id = m_heap[0];
+	remove(id);
+	return id;
+}
+
+template <class Compare>
+void index_heap<Compare>::remove(int id)
+{
+	Assert_return(contains(id));
+
+	int index = m_pos[id];
+	m_pos[id] = -1;
+	m_size--;
+	if (index == m_size) {
+		return;
+	}
+
+	// fill the hole with the last id, which may need to go either way.
+	int moved = m_heap[m_size];
+	place(moved, index);
+	sift_up(index);
+	sift_down(m_pos[moved]);
+}
+
+// Re-sort an id whose ordering has changed.
+//
+template <class Compare>
+void index_heap<Compare>::update(int id)
+{
+	Assert_return(contains(id));
+
+	int index = m_pos[id];
+	sift_up(index);
+	sift_down(m_pos[id]);
+}
+
+template <class Compare>
+void index_heap<Compare>::clear()
+{
+	for (int i = 0; i < m_size; i++) {
+		m_pos[m_heap[i]] = -1;
+	}
+	m_size = 0;
+}
+
+#endif // __INDEX_HEAP_H